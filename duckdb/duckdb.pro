@@ -12,8 +12,12 @@ include($$PWD/duckdb/duckdb.pri)
 # target.path = $$[QT_INSTALL_PLUGINS]/sqldrivers/
 # INSTALLS += target
 
-HEADERS += $$PWD/qsql_duckdb_p.h
-SOURCES += $$PWD/qsql_duckdb.cpp $$PWD/smain.cpp
+HEADERS += $$PWD/qsql_duckdb_p.h \
+           $$PWD/qsql_duckdb_rows.h \
+           $$PWD/qsql_duckdb_arrow.h \
+           $$PWD/qsql_duckdb_arrow_ipc_p.h \
+           $$PWD/qsql_duckdb_database_p.h
+SOURCES += $$PWD/qsql_duckdb.cpp $$PWD/qsql_duckdb_arrow_ipc.cpp $$PWD/qsql_duckdb_database.cpp $$PWD/smain.cpp
 
 OTHER_FILES += duckdb.json
 
@@ -38,16 +38,36 @@
 ****************************************************************************/
 
 #include "qsql_duckdb_p.h"
+#include "qsql_duckdb_rows.h"
+#include "qsql_duckdb_arrow.h"
+#include "qsql_duckdb_arrow_ipc_p.h"
+#include "qsql_duckdb_database_p.h"
 
 #include <qcoreapplication.h>
 #include <qdatetime.h>
+#include <qelapsedtimer.h>
+#include <qfutureinterface.h>
+#include <qtimezone.h>
 #include <qvariant.h>
 #include <qsqlerror.h>
 #include <qsqlfield.h>
 #include <qsqlindex.h>
 #include <qsqlquery.h>
-#include <QtSql/private/qsqlcachedresult_p.h>
 #include <QtSql/private/qsqldriver_p.h>
+#include <qhash.h>
+#include <qsharedpointer.h>
+#include <qiodevice.h>
+#include <qfiledevice.h>
+#include <qbuffer.h>
+#include <qtemporaryfile.h>
+#include <qmetaobject.h>
+#include <qrandom.h>
+#include <qreadwritelock.h>
+#include <qsemaphore.h>
+#include <qthread.h>
+#include <qtimer.h>
+#include <qendian.h>
+#include <quuid.h>
 #include <qstringlist.h>
 #include <qvector.h>
 #include <qdebug.h>
@@ -63,7 +83,13 @@
 # include <unistd.h>
 #endif
 
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <limits>
 #include <functional>
+#include <vector>
 
 Q_DECLARE_OPAQUE_POINTER(duckdb_database *)
 Q_DECLARE_METATYPE(duckdb_database *)
@@ -96,73 +122,2402 @@ static QString _q_escapeIdentifier(const QString &identifier, QSqlDriver::Identi
     return res;
 }
 
-static QVariant::Type qGetColumnType(const QString &tpName)
+/*
+   The type of a column from its name in the DuckDB catalog (duckdb_columns().data_type),
+   which spells out parameters and nested types, like DECIMAL(18,3) or INTEGER[].
+*/
+static duckdb_type qTypeFromName(const QString &typeName)
+{
+    static const struct {
+        const char *name;
+        duckdb_type type;
+    } types[] = {
+        { "BOOLEAN", DUCKDB_TYPE_BOOLEAN },
+        { "TINYINT", DUCKDB_TYPE_TINYINT },
+        { "SMALLINT", DUCKDB_TYPE_SMALLINT },
+        { "INTEGER", DUCKDB_TYPE_INTEGER },
+        { "BIGINT", DUCKDB_TYPE_BIGINT },
+        { "HUGEINT", DUCKDB_TYPE_HUGEINT },
+        { "UTINYINT", DUCKDB_TYPE_UTINYINT },
+        { "USMALLINT", DUCKDB_TYPE_USMALLINT },
+        { "UINTEGER", DUCKDB_TYPE_UINTEGER },
+        { "UBIGINT", DUCKDB_TYPE_UBIGINT },
+        { "UHUGEINT", DUCKDB_TYPE_UHUGEINT },
+        { "FLOAT", DUCKDB_TYPE_FLOAT },
+        { "DOUBLE", DUCKDB_TYPE_DOUBLE },
+        { "DATE", DUCKDB_TYPE_DATE },
+        { "TIME", DUCKDB_TYPE_TIME },
+        { "TIME WITH TIME ZONE", DUCKDB_TYPE_TIME_TZ },
+        { "TIMESTAMP", DUCKDB_TYPE_TIMESTAMP },
+        { "TIMESTAMP WITH TIME ZONE", DUCKDB_TYPE_TIMESTAMP_TZ },
+        { "TIMESTAMP_S", DUCKDB_TYPE_TIMESTAMP_S },
+        { "TIMESTAMP_MS", DUCKDB_TYPE_TIMESTAMP_MS },
+        { "TIMESTAMP_NS", DUCKDB_TYPE_TIMESTAMP_NS },
+        { "INTERVAL", DUCKDB_TYPE_INTERVAL },
+        { "VARCHAR", DUCKDB_TYPE_VARCHAR },
+        { "BLOB", DUCKDB_TYPE_BLOB },
+        { "UUID", DUCKDB_TYPE_UUID },
+        { "BIT", DUCKDB_TYPE_BIT },
+        { "VARINT", DUCKDB_TYPE_VARINT },
+        { "NULL", DUCKDB_TYPE_SQLNULL },
+    };
+
+    const QString name = typeName.trimmed().toUpper();
+    if (name.endsWith(QLatin1Char(']')))
+        return name.endsWith(QLatin1String("[]")) ? DUCKDB_TYPE_LIST : DUCKDB_TYPE_ARRAY;
+    if (name.startsWith(QLatin1String("DECIMAL")) || name.startsWith(QLatin1String("NUMERIC")))
+        return DUCKDB_TYPE_DECIMAL;
+    if (name.startsWith(QLatin1String("STRUCT(")))
+        return DUCKDB_TYPE_STRUCT;
+    if (name.startsWith(QLatin1String("MAP(")))
+        return DUCKDB_TYPE_MAP;
+    if (name.startsWith(QLatin1String("UNION(")))
+        return DUCKDB_TYPE_UNION;
+    if (name.startsWith(QLatin1String("ENUM(")))
+        return DUCKDB_TYPE_ENUM;
+    for (const auto &type : types) {
+        if (name == QLatin1String(type.name))
+            return type.type;
+    }
+    // user defined types and aliases such as JSON are stored as text
+    return DUCKDB_TYPE_VARCHAR;
+}
+
+static QSqlError qMakeError(const QString &descr,const char *error_message,QSqlError::ErrorType type,
+                            int errorCode)
+{
+    return QSqlError(descr,QString::fromLocal8Bit(error_message),type, QString::number(errorCode));
+}
+
+// days between 4713-01-01 BC (julian day 0) and 1970-01-01, DuckDB's date epoch
+static const qint64 qJulianDayOfEpoch = 2440588;
+
+// milliseconds since the epoch of a timestamp counted in units of 1 / perMSec ms, rounded down
+static inline qint64 qTimestampMSecs(int64_t value, qint64 perMSec)
+{
+    return value / perMSec - (value % perMSec < 0 ? 1 : 0);
+}
+
+static QVariant qVectorValue(duckdb_type type, const void *data, idx_t row)
 {
-    const QString typeName = tpName.toLower();
+    switch (type) {
+    case DUCKDB_TYPE_BOOLEAN:
+        return static_cast<const bool *>(data)[row];
+    case DUCKDB_TYPE_TINYINT:
+        return int(static_cast<const int8_t *>(data)[row]);
+    case DUCKDB_TYPE_SMALLINT:
+        return int(static_cast<const int16_t *>(data)[row]);
+    case DUCKDB_TYPE_INTEGER:
+        return static_cast<const int32_t *>(data)[row];
+    case DUCKDB_TYPE_BIGINT:
+        return qint64(static_cast<const int64_t *>(data)[row]);
+    case DUCKDB_TYPE_UTINYINT:
+        return uint(static_cast<const uint8_t *>(data)[row]);
+    case DUCKDB_TYPE_USMALLINT:
+        return uint(static_cast<const uint16_t *>(data)[row]);
+    case DUCKDB_TYPE_UINTEGER:
+        return static_cast<const uint32_t *>(data)[row];
+    case DUCKDB_TYPE_UBIGINT:
+        return quint64(static_cast<const uint64_t *>(data)[row]);
+    case DUCKDB_TYPE_FLOAT:
+        return static_cast<const float *>(data)[row];
+    case DUCKDB_TYPE_DOUBLE:
+        return static_cast<const double *>(data)[row];
+    case DUCKDB_TYPE_DATE:
+        return QDate::fromJulianDay(static_cast<const duckdb_date *>(data)[row].days + qJulianDayOfEpoch);
+    case DUCKDB_TYPE_TIME:
+        return QTime::fromMSecsSinceStartOfDay(int(static_cast<const duckdb_time *>(data)[row].micros / 1000));
+    case DUCKDB_TYPE_TIMESTAMP:
+    case DUCKDB_TYPE_TIMESTAMP_TZ:
+        return QDateTime::fromMSecsSinceEpoch(qTimestampMSecs(static_cast<const duckdb_timestamp *>(data)[row].micros, 1000), Qt::UTC);
+    case DUCKDB_TYPE_TIMESTAMP_S:
+        return QDateTime::fromMSecsSinceEpoch(static_cast<const duckdb_timestamp *>(data)[row].micros * 1000, Qt::UTC);
+    case DUCKDB_TYPE_TIMESTAMP_MS:
+        return QDateTime::fromMSecsSinceEpoch(static_cast<const duckdb_timestamp *>(data)[row].micros, Qt::UTC);
+    case DUCKDB_TYPE_TIMESTAMP_NS:
+        return QDateTime::fromMSecsSinceEpoch(qTimestampMSecs(static_cast<const duckdb_timestamp *>(data)[row].micros, 1000000), Qt::UTC);
+    case DUCKDB_TYPE_HUGEINT:
+        return duckdb_hugeint_to_double(static_cast<const duckdb_hugeint *>(data)[row]);
+    case DUCKDB_TYPE_UHUGEINT:
+        return duckdb_uhugeint_to_double(static_cast<const duckdb_uhugeint *>(data)[row]);
+    case DUCKDB_TYPE_UUID: {
+        // stored as a hugeint with the sign bit flipped so that UUIDs sort as unsigned
+        const duckdb_hugeint &value = static_cast<const duckdb_hugeint *>(data)[row];
+        char bytes[16];
+        qToBigEndian<quint64>(quint64(value.upper) ^ (Q_UINT64_C(1) << 63), bytes);
+        qToBigEndian<quint64>(value.lower, bytes + 8);
+        return QUuid::fromRfc4122(QByteArray::fromRawData(bytes, 16));
+    }
+    case DUCKDB_TYPE_VARCHAR: {
+        const duckdb_string_t &str = static_cast<const duckdb_string_t *>(data)[row];
+        return QString::fromUtf8(QDuckdb::stringData(str), int(str.value.inlined.length));
+    }
+    case DUCKDB_TYPE_BLOB: {
+        const duckdb_string_t &str = static_cast<const duckdb_string_t *>(data)[row];
+        return QByteArray(QDuckdb::stringData(str), int(str.value.inlined.length));
+    }
+    default:
+        // reported once per column by initColumns()
+        return QVariant();
+    }
+}
 
-    if (typeName == QLatin1String("integer")
-        || typeName == QLatin1String("int"))
+// QVariant type of the values decoded from a column, used for the field and for NULLs
+static QVariant::Type qVariantType(duckdb_type type)
+{
+    switch (type) {
+    case DUCKDB_TYPE_BOOLEAN:
+        return QVariant::Bool;
+    case DUCKDB_TYPE_TINYINT:
+    case DUCKDB_TYPE_SMALLINT:
+    case DUCKDB_TYPE_INTEGER:
         return QVariant::Int;
-    if (typeName == QLatin1String("double")
-        || typeName == QLatin1String("float")
-        || typeName == QLatin1String("real")
-        || typeName.startsWith(QLatin1String("numeric")))
+    case DUCKDB_TYPE_BIGINT:
+        return QVariant::LongLong;
+    case DUCKDB_TYPE_UTINYINT:
+    case DUCKDB_TYPE_USMALLINT:
+    case DUCKDB_TYPE_UINTEGER:
+        return QVariant::UInt;
+    case DUCKDB_TYPE_UBIGINT:
+        return QVariant::ULongLong;
+    case DUCKDB_TYPE_FLOAT:
+    case DUCKDB_TYPE_DOUBLE:
+    case DUCKDB_TYPE_HUGEINT:
+    case DUCKDB_TYPE_UHUGEINT:
         return QVariant::Double;
-    if (typeName == QLatin1String("blob"))
+    case DUCKDB_TYPE_DATE:
+        return QVariant::Date;
+    case DUCKDB_TYPE_TIME:
+        return QVariant::Time;
+    case DUCKDB_TYPE_TIMESTAMP:
+    case DUCKDB_TYPE_TIMESTAMP_TZ:
+    case DUCKDB_TYPE_TIMESTAMP_S:
+    case DUCKDB_TYPE_TIMESTAMP_MS:
+    case DUCKDB_TYPE_TIMESTAMP_NS:
+        return QVariant::DateTime;
+    case DUCKDB_TYPE_VARCHAR:
+    case DUCKDB_TYPE_ENUM:
+        return QVariant::String;
+    case DUCKDB_TYPE_BLOB:
         return QVariant::ByteArray;
-    if (typeName == QLatin1String("boolean")
-        || typeName == QLatin1String("bool"))
-        return QVariant::Bool;
-    return QVariant::String;
+    case DUCKDB_TYPE_UUID:
+        return QVariant::Uuid;
+    case DUCKDB_TYPE_LIST:
+    case DUCKDB_TYPE_ARRAY:
+        return QVariant::List;
+    case DUCKDB_TYPE_STRUCT:
+    case DUCKDB_TYPE_MAP:
+        return QVariant::Map;
+    default:
+        return QVariant::Invalid;
+    }
 }
 
-static QSqlError qMakeError(const QString &descr,const char *error_message,QSqlError::ErrorType type,
-                            int errorCode)
+// QVariant type of floating point (exact == false) and DECIMAL/HUGEINT columns under policy
+static QVariant::Type qNumericVariantType(QSql::NumericalPrecisionPolicy policy, bool exact)
 {
-    return QSqlError(descr,QString::fromLocal8Bit(error_message),type, QString::number(errorCode));
+    switch (policy) {
+    case QSql::LowPrecisionInt32:
+        return QVariant::Int;
+    case QSql::LowPrecisionInt64:
+        return QVariant::LongLong;
+    case QSql::HighPrecision:
+        return exact ? QVariant::String : QVariant::Double;
+    default:
+        return QVariant::Double;
+    }
+}
+
+// the QVariant type of a column of a table record, the same as in the records of query results
+static QVariant::Type qFieldType(duckdb_type type, QSql::NumericalPrecisionPolicy policy)
+{
+    switch (type) {
+    case DUCKDB_TYPE_DECIMAL:
+    case DUCKDB_TYPE_HUGEINT:
+        return qNumericVariantType(policy, true);
+    case DUCKDB_TYPE_FLOAT:
+    case DUCKDB_TYPE_DOUBLE:
+        return qNumericVariantType(policy, false);
+    default: {
+        const QVariant::Type variantType = qVariantType(type);
+        return variantType == QVariant::Invalid ? QVariant::String : variantType;
+    }
+    }
+}
+
+// the cache is shared by connections with different precision policies, so field types are set on the way out
+template <typename Record>
+static Record qApplyPrecisionPolicy(Record record, QSql::NumericalPrecisionPolicy policy)
+{
+    for (int i = 0; i < record.count(); ++i) {
+        QSqlField field = record.field(i);
+        field.setType(qFieldType(duckdb_type(field.typeID()), policy));
+        record.replace(i, field);
+    }
+    return record;
+}
+
+/*
+   Interning table of one VARCHAR column. Repeated values share one QString,
+   found by hashing the UTF-8 bytes, so a hit allocates nothing. The table stops
+   growing at qInternLimit entries, by then the column is not low cardinality.
+*/
+class QDuckdbStringTable
+{
+public:
+    QString intern(const char *data, int size)
+    {
+        const uint hash = qHashBits(data, size_t(size));
+        for (auto it = index.constFind(hash); it != index.constEnd() && it.key() == hash; ++it) {
+            const QPair<QByteArray, QString> &entry = values.at(it.value());
+            if (entry.first.size() == size && memcmp(entry.first.constData(), data, size_t(size)) == 0)
+                return entry.second;
+        }
+        QString str = QString::fromUtf8(data, size);
+        if (values.size() < qInternLimit) {
+            index.insert(hash, values.size());
+            values.append(qMakePair(QByteArray(data, size), str));
+        }
+        return str;
+    }
+
+    bool isFull() const { return values.size() >= qInternLimit; }
+
+private:
+    static const int qInternLimit = 4096;
+    QMultiHash<uint, int> index;
+    QVector<QPair<QByteArray, QString>> values;
+};
+
+/*
+   Shape of a result column, built once per result from its logical type so
+   that nested values are decoded without asking DuckDB for types per row.
+   STRUCT field and UNION member names are interned here and shared by every
+   decoded QVariantMap, and so are the ENUM dictionary entries.
+*/
+struct QDuckdbColumnType
+{
+    duckdb_type type = DUCKDB_TYPE_INVALID;
+    QVariant::Type variantType = QVariant::Invalid;
+    QSql::NumericalPrecisionPolicy precisionPolicy = QSql::LowPrecisionDouble;
+    // DECIMAL and HUGEINT, the integer type holding the unscaled value; ENUM, the type of the index
+    duckdb_type storageType = DUCKDB_TYPE_INVALID;
+    int scale = 0;
+    // TIMESTAMP_TZ, the session time zone the values are shown in
+    QTimeZone timeZone;
+    // BLOB, values reference the chunk pinned by the result instead of being copied
+    bool rawData = false;
+    // VARCHAR, shared by the values of a low cardinality column with QDUCKDB_INTERN_STRINGS
+    QSharedPointer<QDuckdbStringTable> strings;
+    idx_t arraySize = 0;
+    // STRUCT field names, UNION member names or the ENUM dictionary
+    QVector<QString> keys;
+    std::vector<QDuckdbColumnType> children;
+
+    bool isNested() const { return !children.empty(); }
+};
+
+static QDuckdbColumnType qColumnType(duckdb_logical_type logicalType, QSql::NumericalPrecisionPolicy policy)
+{
+    QDuckdbColumnType column;
+    column.type = duckdb_get_type_id(logicalType);
+    column.variantType = qVariantType(column.type);
+    column.precisionPolicy = policy;
+
+    const auto addChild = [&column, policy](duckdb_logical_type child) {
+        column.children.push_back(qColumnType(child, policy));
+        duckdb_destroy_logical_type(&child);
+    };
+    const auto addKey = [&column](char *name) {
+        column.keys.append(QString::fromUtf8(name));
+        duckdb_free(name);
+    };
+
+    switch (column.type) {
+    case DUCKDB_TYPE_LIST:
+        addChild(duckdb_list_type_child_type(logicalType));
+        break;
+    case DUCKDB_TYPE_ARRAY:
+        column.arraySize = duckdb_array_type_array_size(logicalType);
+        addChild(duckdb_array_type_child_type(logicalType));
+        break;
+    case DUCKDB_TYPE_MAP:
+        addChild(duckdb_map_type_key_type(logicalType));
+        addChild(duckdb_map_type_value_type(logicalType));
+        break;
+    case DUCKDB_TYPE_STRUCT:
+        for (idx_t i = 0; i < duckdb_struct_type_child_count(logicalType); ++i) {
+            addKey(duckdb_struct_type_child_name(logicalType, i));
+            addChild(duckdb_struct_type_child_type(logicalType, i));
+        }
+        break;
+    case DUCKDB_TYPE_UNION:
+        for (idx_t i = 0; i < duckdb_union_type_member_count(logicalType); ++i) {
+            addKey(duckdb_union_type_member_name(logicalType, i));
+            addChild(duckdb_union_type_member_type(logicalType, i));
+        }
+        // the set member decides the type of each value
+        column.variantType = QVariant::Invalid;
+        break;
+    case DUCKDB_TYPE_DECIMAL:
+        column.storageType = duckdb_decimal_internal_type(logicalType);
+        column.scale = duckdb_decimal_scale(logicalType);
+        column.variantType = qNumericVariantType(policy, true);
+        break;
+    case DUCKDB_TYPE_HUGEINT:
+        column.storageType = DUCKDB_TYPE_HUGEINT;
+        column.variantType = qNumericVariantType(policy, true);
+        break;
+    case DUCKDB_TYPE_FLOAT:
+    case DUCKDB_TYPE_DOUBLE:
+        column.variantType = qNumericVariantType(policy, false);
+        break;
+    case DUCKDB_TYPE_ENUM: {
+        column.storageType = duckdb_enum_internal_type(logicalType);
+        const uint32_t size = duckdb_enum_dictionary_size(logicalType);
+        column.keys.reserve(int(size));
+        for (uint32_t i = 0; i < size; ++i)
+            addKey(duckdb_enum_dictionary_value(logicalType, i));
+        break;
+    }
+    default:
+        break;
+    }
+    return column;
+}
+
+static qint64 qEnumIndex(duckdb_type storageType, const void *data, idx_t row)
+{
+    switch (storageType) {
+    case DUCKDB_TYPE_UTINYINT:
+        return static_cast<const uint8_t *>(data)[row];
+    case DUCKDB_TYPE_USMALLINT:
+        return static_cast<const uint16_t *>(data)[row];
+    default:
+        return static_cast<const uint32_t *>(data)[row];
+    }
+}
+
+// gives every VARCHAR column of the tree its own interning table
+static void qSetStringTables(QDuckdbColumnType &column)
+{
+    if (column.type == DUCKDB_TYPE_VARCHAR)
+        column.strings.reset(new QDuckdbStringTable);
+    for (QDuckdbColumnType &child : column.children)
+        qSetStringTables(child);
+}
+
+static bool qHasBlob(const QDuckdbColumnType &column)
+{
+    return column.type == DUCKDB_TYPE_BLOB
+            || std::any_of(column.children.cbegin(), column.children.cend(), qHasBlob);
+}
+
+static void qSetRawData(QDuckdbColumnType &column, bool enabled)
+{
+    column.rawData = enabled && column.type == DUCKDB_TYPE_BLOB;
+    for (QDuckdbColumnType &child : column.children)
+        qSetRawData(child, enabled);
+}
+
+static bool qHasTimeZone(const QDuckdbColumnType &column)
+{
+    return column.type == DUCKDB_TYPE_TIMESTAMP_TZ
+            || std::any_of(column.children.cbegin(), column.children.cend(), qHasTimeZone);
+}
+
+// assigns timeZone to every TIMESTAMP_TZ column of the tree
+static void qSetTimeZone(QDuckdbColumnType &column, const QTimeZone &timeZone)
+{
+    if (column.type == DUCKDB_TYPE_TIMESTAMP_TZ)
+        column.timeZone = timeZone;
+    for (QDuckdbColumnType &child : column.children)
+        qSetTimeZone(child, timeZone);
+}
+
+// powers of ten up to the largest scale of a 64-bit DECIMAL
+static const qint64 qPowersOfTen[19] = {
+    1LL, 10LL, 100LL, 1000LL, 10000LL, 100000LL, 1000000LL, 10000000LL, 100000000LL,
+    1000000000LL, 10000000000LL, 100000000000LL, 1000000000000LL, 10000000000000LL,
+    100000000000000LL, 1000000000000000LL, 10000000000000000LL, 100000000000000000LL,
+    1000000000000000000LL
+};
+
+static qint64 qDecimalStorageValue(duckdb_type storageType, const void *data, idx_t row)
+{
+    switch (storageType) {
+    case DUCKDB_TYPE_SMALLINT:
+        return static_cast<const int16_t *>(data)[row];
+    case DUCKDB_TYPE_INTEGER:
+        return static_cast<const int32_t *>(data)[row];
+    default:
+        return static_cast<const int64_t *>(data)[row];
+    }
+}
+
+// decimal digits of a 128-bit two's complement integer
+static QByteArray qHugeintDigits(const duckdb_hugeint &value)
+{
+    quint64 upper = quint64(value.upper);
+    quint64 lower = value.lower;
+    const bool negative = value.upper < 0;
+    if (negative) {
+        lower = ~lower + 1;
+        upper = ~upper + (lower == 0 ? 1 : 0);
+    }
+
+    quint32 limbs[4] = { quint32(upper >> 32), quint32(upper), quint32(lower >> 32), quint32(lower) };
+    char digits[41];
+    int pos = sizeof(digits);
+    bool zero;
+    do {
+        quint64 remainder = 0;
+        zero = true;
+        for (quint32 &limb : limbs) {
+            const quint64 current = (remainder << 32) | limb;
+            limb = quint32(current / 10);
+            remainder = current % 10;
+            zero = zero && limb == 0;
+        }
+        digits[--pos] = char('0' + remainder);
+    } while (!zero);
+    if (negative)
+        digits[--pos] = '-';
+    return QByteArray(digits + pos, int(sizeof(digits)) - pos);
+}
+
+// inserts the decimal point scale digits from the right of an integer
+static QString qDecimalString(QByteArray digits, int scale)
+{
+    if (scale > 0) {
+        const bool negative = digits.startsWith('-');
+        if (negative)
+            digits.remove(0, 1);
+        if (digits.size() <= scale)
+            digits.prepend(QByteArray(scale - digits.size() + 1, '0'));
+        digits.insert(digits.size() - scale, '.');
+        if (negative)
+            digits.prepend('-');
+    }
+    return QString::fromLatin1(digits);
+}
+
+// an integer value under LowPrecisionInt32 or LowPrecisionInt64, saturated to the range of its type
+static QVariant qLowPrecisionInteger(qint64 value, QSql::NumericalPrecisionPolicy policy)
+{
+    if (policy == QSql::LowPrecisionInt32)
+        return int(qBound<qint64>(std::numeric_limits<int>::min(), value, std::numeric_limits<int>::max()));
+    return value;
+}
+
+/*
+   DECIMAL and HUGEINT values are decoded from their unscaled integer storage
+   according to the numerical precision policy; HighPrecision keeps every digit
+   in a string. The integer policies saturate out of range values like they do
+   for FLOAT and DOUBLE columns.
+*/
+static QVariant qNumericValue(const QDuckdbColumnType &column, const void *data, idx_t row)
+{
+    if (column.storageType == DUCKDB_TYPE_HUGEINT) {
+        const duckdb_hugeint &value = static_cast<const duckdb_hugeint *>(data)[row];
+        switch (column.precisionPolicy) {
+        case QSql::LowPrecisionDouble:
+            return duckdb_hugeint_to_double(value) / std::pow(10.0, column.scale);
+        case QSql::HighPrecision:
+            return qDecimalString(qHugeintDigits(value), column.scale);
+        default: {
+            QByteArray digits = qHugeintDigits(value);
+            digits.chop(column.scale);
+            bool ok = true;
+            qint64 integer = digits.isEmpty() || digits == "-" ? 0 : digits.toLongLong(&ok);
+            if (!ok)
+                integer = value.upper < 0 ? std::numeric_limits<qint64>::min() : std::numeric_limits<qint64>::max();
+            return qLowPrecisionInteger(integer, column.precisionPolicy);
+        }
+        }
+    }
+
+    const qint64 value = qDecimalStorageValue(column.storageType, data, row);
+    switch (column.precisionPolicy) {
+    case QSql::LowPrecisionInt32:
+    case QSql::LowPrecisionInt64:
+        return qLowPrecisionInteger(value / qPowersOfTen[column.scale], column.precisionPolicy);
+    case QSql::HighPrecision:
+        return qDecimalString(QByteArray::number(value), column.scale);
+    default:
+        return double(value) / qPowersOfTen[column.scale];
+    }
+}
+
+// value of a non nested column, applying the precision policy to numbers
+static QVariant qColumnValue(const QDuckdbColumnType &column, const void *data, idx_t row)
+{
+    switch (column.type) {
+    case DUCKDB_TYPE_DECIMAL:
+    case DUCKDB_TYPE_HUGEINT:
+        return qNumericValue(column, data, row);
+    case DUCKDB_TYPE_FLOAT:
+    case DUCKDB_TYPE_DOUBLE:
+        if (column.precisionPolicy == QSql::LowPrecisionInt32 || column.precisionPolicy == QSql::LowPrecisionInt64) {
+            const double value = column.type == DUCKDB_TYPE_FLOAT ? static_cast<const float *>(data)[row]
+                                                                   : static_cast<const double *>(data)[row];
+            if (column.precisionPolicy == QSql::LowPrecisionInt32)
+                return int(qBound<double>(std::numeric_limits<int>::min(), value, std::numeric_limits<int>::max()));
+            return qint64(qBound<double>(-9.2e18, value, 9.2e18));
+        }
+        return qVectorValue(column.type, data, row);
+    case DUCKDB_TYPE_TIMESTAMP_TZ:
+        return QDateTime::fromMSecsSinceEpoch(qTimestampMSecs(static_cast<const duckdb_timestamp *>(data)[row].micros, 1000),
+                                              column.timeZone);
+    case DUCKDB_TYPE_BLOB:
+        if (column.rawData) {
+            const duckdb_string_t &str = static_cast<const duckdb_string_t *>(data)[row];
+            return QByteArray::fromRawData(QDuckdb::stringData(str), int(str.value.inlined.length));
+        }
+        return qVectorValue(column.type, data, row);
+    case DUCKDB_TYPE_VARCHAR:
+        if (column.strings && !column.strings->isFull()) {
+            const duckdb_string_t &str = static_cast<const duckdb_string_t *>(data)[row];
+            return column.strings->intern(QDuckdb::stringData(str), int(str.value.inlined.length));
+        }
+        return qVectorValue(column.type, data, row);
+    case DUCKDB_TYPE_ENUM: {
+        const qint64 index = qEnumIndex(column.storageType, data, row);
+        return index < column.keys.size() ? QVariant(column.keys.at(int(index))) : QVariant(QVariant::String);
+    }
+    default:
+        return qVectorValue(column.type, data, row);
+    }
+}
+
+// decodes one value of a vector, recursing into the child vectors of nested types
+static QVariant qDecodeValue(const QDuckdbColumnType &column, duckdb_vector vector, idx_t row)
+{
+    uint64_t *validity = duckdb_vector_get_validity(vector);
+    if (validity && !duckdb_validity_row_is_valid(validity, row))
+        return QVariant(column.variantType);
+
+    const void *data = duckdb_vector_get_data(vector);
+    switch (column.type) {
+    case DUCKDB_TYPE_LIST: {
+        const duckdb_list_entry &entry = static_cast<const duckdb_list_entry *>(data)[row];
+        const duckdb_vector child = duckdb_list_vector_get_child(vector);
+        QVariantList list;
+        list.reserve(int(entry.length));
+        for (idx_t i = 0; i < entry.length; ++i)
+            list.append(qDecodeValue(column.children[0], child, entry.offset + i));
+        return list;
+    }
+    case DUCKDB_TYPE_ARRAY: {
+        const duckdb_vector child = duckdb_array_vector_get_child(vector);
+        QVariantList list;
+        list.reserve(int(column.arraySize));
+        for (idx_t i = 0; i < column.arraySize; ++i)
+            list.append(qDecodeValue(column.children[0], child, row * column.arraySize + i));
+        return list;
+    }
+    case DUCKDB_TYPE_MAP: {
+        // a list of {key, value} structs
+        const duckdb_list_entry &entry = static_cast<const duckdb_list_entry *>(data)[row];
+        const duckdb_vector entries = duckdb_list_vector_get_child(vector);
+        const duckdb_vector keys = duckdb_struct_vector_get_child(entries, 0);
+        const duckdb_vector values = duckdb_struct_vector_get_child(entries, 1);
+        QVariantMap map;
+        for (idx_t i = 0; i < entry.length; ++i) {
+            map.insert(qDecodeValue(column.children[0], keys, entry.offset + i).toString(),
+                       qDecodeValue(column.children[1], values, entry.offset + i));
+        }
+        return map;
+    }
+    case DUCKDB_TYPE_STRUCT: {
+        QVariantMap map;
+        for (idx_t i = 0; i < column.children.size(); ++i) {
+            map.insert(column.keys.at(int(i)),
+                       qDecodeValue(column.children[i], duckdb_struct_vector_get_child(vector, i), row));
+        }
+        return map;
+    }
+    case DUCKDB_TYPE_UNION: {
+        // a struct whose first child holds the tag of the set member
+        const duckdb_vector tags = duckdb_struct_vector_get_child(vector, 0);
+        const idx_t tag = static_cast<const uint8_t *>(duckdb_vector_get_data(tags))[row];
+        if (tag >= column.children.size())
+            return QVariant();
+        return qDecodeValue(column.children[tag], duckdb_struct_vector_get_child(vector, tag + 1), row);
+    }
+    default:
+        return qColumnValue(column, data, row);
+    }
+}
+
+/*
+   Calls valid or null for each of the count rows of a vector. The validity
+   mask is read a 64 bit word at a time, so runs of rows without NULLs and
+   runs of NULLs are handled without testing every bit.
+*/
+template <typename Valid, typename Null>
+static void qForEachRow(const uint64_t *validity, idx_t count, Valid valid, Null null)
+{
+    if (!validity) {
+        for (idx_t row = 0; row < count; ++row)
+            valid(row);
+        return;
+    }
+    for (idx_t base = 0; base < count; base += 64) {
+        const idx_t end = qMin<idx_t>(base + 64, count);
+        const uint64_t word = validity[base / 64];
+        if (word == ~uint64_t(0)) {
+            for (idx_t row = base; row < end; ++row)
+                valid(row);
+        } else if (word == 0) {
+            for (idx_t row = base; row < end; ++row)
+                null(row);
+        } else {
+            for (idx_t row = base; row < end; ++row) {
+                if (word & (uint64_t(1) << (row - base)))
+                    valid(row);
+                else
+                    null(row);
+            }
+        }
+    }
+}
+
+// runs convert over a vector of fixed size values, the decoding kernel of most scalar types
+template <typename T, typename Convert>
+static void qDecodeFixed(const void *data, const uint64_t *validity, idx_t count, QVariant *out, int stride,
+                         QVariant::Type nullType, Convert convert)
+{
+    const T *values = static_cast<const T *>(data);
+    const QVariant nullValue(nullType);
+    qForEachRow(validity, count,
+                [&](idx_t row) { out[row * stride] = convert(values[row]); },
+                [&](idx_t row) { out[row * stride] = nullValue; });
+}
+
+// decodes count values of a vector into out, stride values apart
+static void qDecodeColumn(const QDuckdbColumnType &column, duckdb_vector vector, idx_t count,
+                          QVariant *out, int stride)
+{
+    if (column.isNested()) {
+        for (idx_t row = 0; row < count; ++row, out += stride)
+            *out = qDecodeValue(column, vector, row);
+        return;
+    }
+
+    uint64_t *validity = duckdb_vector_get_validity(vector);
+    const void *data = duckdb_vector_get_data(vector);
+    const QVariant::Type nullType = column.variantType;
+
+    switch (column.type) {
+    case DUCKDB_TYPE_BOOLEAN:
+        qDecodeFixed<bool>(data, validity, count, out, stride, nullType, [](bool value) { return QVariant(value); });
+        return;
+    case DUCKDB_TYPE_TINYINT:
+        qDecodeFixed<int8_t>(data, validity, count, out, stride, nullType, [](int8_t value) { return QVariant(int(value)); });
+        return;
+    case DUCKDB_TYPE_SMALLINT:
+        qDecodeFixed<int16_t>(data, validity, count, out, stride, nullType, [](int16_t value) { return QVariant(int(value)); });
+        return;
+    case DUCKDB_TYPE_INTEGER:
+        qDecodeFixed<int32_t>(data, validity, count, out, stride, nullType, [](int32_t value) { return QVariant(value); });
+        return;
+    case DUCKDB_TYPE_BIGINT:
+        qDecodeFixed<int64_t>(data, validity, count, out, stride, nullType, [](int64_t value) { return QVariant(qint64(value)); });
+        return;
+    case DUCKDB_TYPE_UTINYINT:
+        qDecodeFixed<uint8_t>(data, validity, count, out, stride, nullType, [](uint8_t value) { return QVariant(uint(value)); });
+        return;
+    case DUCKDB_TYPE_USMALLINT:
+        qDecodeFixed<uint16_t>(data, validity, count, out, stride, nullType, [](uint16_t value) { return QVariant(uint(value)); });
+        return;
+    case DUCKDB_TYPE_UINTEGER:
+        qDecodeFixed<uint32_t>(data, validity, count, out, stride, nullType, [](uint32_t value) { return QVariant(value); });
+        return;
+    case DUCKDB_TYPE_UBIGINT:
+        qDecodeFixed<uint64_t>(data, validity, count, out, stride, nullType, [](uint64_t value) { return QVariant(quint64(value)); });
+        return;
+    case DUCKDB_TYPE_FLOAT:
+        // the Int policies round in qColumnValue
+        if (column.variantType != QVariant::Double)
+            break;
+        qDecodeFixed<float>(data, validity, count, out, stride, nullType, [](float value) { return QVariant(value); });
+        return;
+    case DUCKDB_TYPE_DOUBLE:
+        if (column.variantType != QVariant::Double)
+            break;
+        qDecodeFixed<double>(data, validity, count, out, stride, nullType, [](double value) { return QVariant(value); });
+        return;
+    case DUCKDB_TYPE_DECIMAL:
+        // the common DECIMAL(18,8) -> double case
+        if (column.storageType == DUCKDB_TYPE_BIGINT && column.precisionPolicy == QSql::LowPrecisionDouble) {
+            const double divisor = double(qPowersOfTen[column.scale]);
+            qDecodeFixed<int64_t>(data, validity, count, out, stride, nullType, [divisor](int64_t value) {
+                return QVariant(double(value) / divisor);
+            });
+            return;
+        }
+        break;
+    case DUCKDB_TYPE_DATE:
+        qDecodeFixed<duckdb_date>(data, validity, count, out, stride, nullType, [](duckdb_date value) {
+            return QVariant(QDate::fromJulianDay(value.days + qJulianDayOfEpoch));
+        });
+        return;
+    case DUCKDB_TYPE_TIME:
+        qDecodeFixed<duckdb_time>(data, validity, count, out, stride, nullType, [](duckdb_time value) {
+            return QVariant(QTime::fromMSecsSinceStartOfDay(int(value.micros / 1000)));
+        });
+        return;
+    case DUCKDB_TYPE_TIMESTAMP:
+        qDecodeFixed<duckdb_timestamp>(data, validity, count, out, stride, nullType, [](duckdb_timestamp value) {
+            return QVariant(QDateTime::fromMSecsSinceEpoch(qTimestampMSecs(value.micros, 1000), Qt::UTC));
+        });
+        return;
+    case DUCKDB_TYPE_TIMESTAMP_S:
+        qDecodeFixed<duckdb_timestamp>(data, validity, count, out, stride, nullType, [](duckdb_timestamp value) {
+            return QVariant(QDateTime::fromMSecsSinceEpoch(value.micros * 1000, Qt::UTC));
+        });
+        return;
+    case DUCKDB_TYPE_TIMESTAMP_MS:
+        qDecodeFixed<duckdb_timestamp>(data, validity, count, out, stride, nullType, [](duckdb_timestamp value) {
+            return QVariant(QDateTime::fromMSecsSinceEpoch(value.micros, Qt::UTC));
+        });
+        return;
+    case DUCKDB_TYPE_TIMESTAMP_NS:
+        qDecodeFixed<duckdb_timestamp>(data, validity, count, out, stride, nullType, [](duckdb_timestamp value) {
+            return QVariant(QDateTime::fromMSecsSinceEpoch(qTimestampMSecs(value.micros, 1000000), Qt::UTC));
+        });
+        return;
+    case DUCKDB_TYPE_VARCHAR:
+        if (column.strings)
+            break;
+        qDecodeFixed<duckdb_string_t>(data, validity, count, out, stride, nullType, [](const duckdb_string_t &str) {
+            return QVariant(QString::fromUtf8(QDuckdb::stringData(str), int(str.value.inlined.length)));
+        });
+        return;
+    case DUCKDB_TYPE_ENUM: {
+        // each row takes an implicitly shared copy of its dictionary entry
+        const QVector<QString> &dictionary = column.keys;
+        const auto lookup = [&dictionary](uint32_t index) {
+            return index < uint32_t(dictionary.size()) ? QVariant(dictionary.at(int(index))) : QVariant(QVariant::String);
+        };
+        if (column.storageType == DUCKDB_TYPE_UTINYINT)
+            qDecodeFixed<uint8_t>(data, validity, count, out, stride, nullType, lookup);
+        else if (column.storageType == DUCKDB_TYPE_USMALLINT)
+            qDecodeFixed<uint16_t>(data, validity, count, out, stride, nullType, lookup);
+        else
+            qDecodeFixed<uint32_t>(data, validity, count, out, stride, nullType, lookup);
+        return;
+    }
+    case DUCKDB_TYPE_BLOB:
+        if (column.rawData) {
+            qDecodeFixed<duckdb_string_t>(data, validity, count, out, stride, nullType, [](const duckdb_string_t &str) {
+                return QVariant(QByteArray::fromRawData(QDuckdb::stringData(str), int(str.value.inlined.length)));
+            });
+        } else {
+            qDecodeFixed<duckdb_string_t>(data, validity, count, out, stride, nullType, [](const duckdb_string_t &str) {
+                return QVariant(QByteArray(QDuckdb::stringData(str), int(str.value.inlined.length)));
+            });
+        }
+        return;
+    case DUCKDB_TYPE_TIMESTAMP_TZ: {
+        const QTimeZone &timeZone = column.timeZone;
+        qDecodeFixed<duckdb_timestamp>(data, validity, count, out, stride, nullType, [&timeZone](duckdb_timestamp value) {
+            return QVariant(QDateTime::fromMSecsSinceEpoch(qTimestampMSecs(value.micros, 1000), timeZone));
+        });
+        return;
+    }
+    default:
+        break;
+    }
+
+    const QVariant nullValue(nullType);
+    qForEachRow(validity, count,
+                [&](idx_t row) { out[row * stride] = qColumnValue(column, data, row); },
+                [&](idx_t row) { out[row * stride] = nullValue; });
+}
+
+static duckdb_state qAppendValue(duckdb_appender appender, const QVariant &value)
+{
+    if (value.isNull())
+        return duckdb_append_null(appender);
+
+    switch (value.userType()) {
+    case QVariant::Bool:
+        return duckdb_append_bool(appender, value.toBool());
+    case QVariant::Int:
+        return duckdb_append_int32(appender, value.toInt());
+    case QVariant::UInt:
+        return duckdb_append_uint32(appender, value.toUInt());
+    case QVariant::LongLong:
+        return duckdb_append_int64(appender, value.toLongLong());
+    case QVariant::ULongLong:
+        return duckdb_append_uint64(appender, value.toULongLong());
+    case QMetaType::Float:
+        return duckdb_append_float(appender, value.toFloat());
+    case QVariant::Double:
+        return duckdb_append_double(appender, value.toDouble());
+    case QVariant::Date:
+        return duckdb_append_date(appender, duckdb_date{ int32_t(value.toDate().toJulianDay() - qJulianDayOfEpoch) });
+    case QVariant::Time:
+        return duckdb_append_time(appender, duckdb_time{ value.toTime().msecsSinceStartOfDay() * qint64(1000) });
+    case QVariant::DateTime:
+        return duckdb_append_timestamp(appender, duckdb_timestamp{ value.toDateTime().toMSecsSinceEpoch() * 1000 });
+    case QVariant::ByteArray: {
+        const QByteArray *ba = static_cast<const QByteArray*>(value.constData());
+        return duckdb_append_blob(appender, ba->constData(), ba->size());
+    }
+    default: {
+        const QByteArray str = value.toString().toUtf8();
+        return duckdb_append_varchar_length(appender, str.constData(), str.size());
+    }
+    }
+}
+
+/*
+   A Q_GADGET property, read and written through the static metacall of the
+   meta-object declaring it as QMetaProperty does, but for the common types
+   into a variable of the property type rather than a QVariant. Properties of
+   other types, and columns whose type does not match, go through
+   readOnGadget() and writeOnGadget().
+*/
+struct QDuckdbGadgetProperty
+{
+    enum Type { Variant, Int, LongLong, Double, Bool, String, ByteArray, Date, DateTime };
+
+    QDuckdbGadgetProperty() = default;
+    explicit QDuckdbGadgetProperty(const QMetaProperty &property);
+
+    bool isValid() const { return property.isValid(); }
+    template <typename T>
+    T read(const void *gadget) const;
+    template <typename T>
+    void write(void *gadget, const T &value) const;
+
+    QVariant readVariant(const void *gadget) const;
+    duckdb_state append(duckdb_appender appender, const void *gadget) const;
+    // whether values of column are decoded straight into the property, the precision
+    // policy and time zone of the column would change them otherwise
+    bool decodes(const QDuckdbColumnType &column) const;
+    void decode(void *gadget, const QDuckdb::Column &column, const void *data, idx_t row) const;
+
+    QMetaProperty property;
+    Type type = Variant;
+    void (*metacall)(QObject *, QMetaObject::Call, int, void **) = nullptr;
+    // relative to the meta-object declaring the property
+    int index = -1;
+};
+
+QDuckdbGadgetProperty::QDuckdbGadgetProperty(const QMetaProperty &property)
+    : property(property)
+{
+    const QMetaObject *owner = property.enclosingMetaObject();
+    if (!owner || !owner->d.static_metacall || !property.isReadable())
+        return;
+    switch (property.userType()) {
+    case QMetaType::Int:
+        type = Int;
+        break;
+    case QMetaType::LongLong:
+        type = LongLong;
+        break;
+    case QMetaType::Double:
+        type = Double;
+        break;
+    case QMetaType::Bool:
+        type = Bool;
+        break;
+    case QMetaType::QString:
+        type = String;
+        break;
+    case QMetaType::QByteArray:
+        type = ByteArray;
+        break;
+    case QMetaType::QDate:
+        type = Date;
+        break;
+    case QMetaType::QDateTime:
+        type = DateTime;
+        break;
+    default:
+        return;
+    }
+    metacall = owner->d.static_metacall;
+    index = property.propertyIndex() - owner->propertyOffset();
+}
+
+template <typename T>
+T QDuckdbGadgetProperty::read(const void *gadget) const
+{
+    T value = T();
+    void *argv[] = { &value };
+    metacall(reinterpret_cast<QObject *>(const_cast<void *>(gadget)), QMetaObject::ReadProperty, index, argv);
+    return value;
+}
+
+// like writeOnGadget(), a property without WRITE or MEMBER is left unchanged
+template <typename T>
+void QDuckdbGadgetProperty::write(void *gadget, const T &value) const
+{
+    int status = -1;
+    int flags = 0;
+    void *argv[] = { const_cast<T *>(&value), nullptr, &status, &flags };
+    metacall(reinterpret_cast<QObject *>(gadget), QMetaObject::WriteProperty, index, argv);
+}
+
+QVariant QDuckdbGadgetProperty::readVariant(const void *gadget) const
+{
+    switch (type) {
+    case Int:
+        return read<int>(gadget);
+    case LongLong:
+        return read<qint64>(gadget);
+    case Double:
+        return read<double>(gadget);
+    case Bool:
+        return read<bool>(gadget);
+    case String:
+        return read<QString>(gadget);
+    case ByteArray:
+        return read<QByteArray>(gadget);
+    case Date:
+        return read<QDate>(gadget);
+    case DateTime:
+        return read<QDateTime>(gadget);
+    default:
+        return property.readOnGadget(gadget);
+    }
+}
+
+// null strings, arrays, dates and date times are appended as NULL, as qAppendValue() does
+duckdb_state QDuckdbGadgetProperty::append(duckdb_appender appender, const void *gadget) const
+{
+    switch (type) {
+    case Int:
+        return duckdb_append_int32(appender, read<int>(gadget));
+    case LongLong:
+        return duckdb_append_int64(appender, read<qint64>(gadget));
+    case Double:
+        return duckdb_append_double(appender, read<double>(gadget));
+    case Bool:
+        return duckdb_append_bool(appender, read<bool>(gadget));
+    case String: {
+        const QString value = read<QString>(gadget);
+        if (value.isNull())
+            return duckdb_append_null(appender);
+        const QByteArray str = value.toUtf8();
+        return duckdb_append_varchar_length(appender, str.constData(), str.size());
+    }
+    case ByteArray: {
+        const QByteArray value = read<QByteArray>(gadget);
+        if (value.isNull())
+            return duckdb_append_null(appender);
+        return duckdb_append_blob(appender, value.constData(), value.size());
+    }
+    case Date: {
+        const QDate value = read<QDate>(gadget);
+        if (value.isNull())
+            return duckdb_append_null(appender);
+        return duckdb_append_date(appender, duckdb_date{ int32_t(value.toJulianDay() - qJulianDayOfEpoch) });
+    }
+    case DateTime: {
+        const QDateTime value = read<QDateTime>(gadget);
+        if (value.isNull())
+            return duckdb_append_null(appender);
+        return duckdb_append_timestamp(appender, duckdb_timestamp{ value.toMSecsSinceEpoch() * 1000 });
+    }
+    default:
+        return qAppendValue(appender, property.readOnGadget(gadget));
+    }
+}
+
+bool QDuckdbGadgetProperty::decodes(const QDuckdbColumnType &column) const
+{
+    const QDuckdb::Column decoded = { column.type, column.storageType, quint8(column.scale) };
+    switch (type) {
+    case Int:
+        return QDuckdb::ColumnDecoder<qint32>::accepts(decoded);
+    case LongLong:
+        return QDuckdb::ColumnDecoder<qint64>::accepts(decoded);
+    case Double:
+        return (column.type == DUCKDB_TYPE_DOUBLE || column.type == DUCKDB_TYPE_FLOAT)
+                && column.precisionPolicy != QSql::LowPrecisionInt32 && column.precisionPolicy != QSql::LowPrecisionInt64;
+    case Bool:
+        return column.type == DUCKDB_TYPE_BOOLEAN;
+    case String:
+        return column.type == DUCKDB_TYPE_VARCHAR;
+    case ByteArray:
+        return QDuckdb::ColumnDecoder<QByteArray>::accepts(decoded);
+    case Date:
+        return column.type == DUCKDB_TYPE_DATE;
+    case DateTime:
+        return column.type == DUCKDB_TYPE_TIMESTAMP;
+    default:
+        return false;
+    }
+}
+
+void QDuckdbGadgetProperty::decode(void *gadget, const QDuckdb::Column &column, const void *data, idx_t row) const
+{
+    switch (type) {
+    case Int:
+        write<int>(gadget, QDuckdb::ColumnDecoder<qint32>::read(column, data, row));
+        break;
+    case LongLong:
+        write<qint64>(gadget, QDuckdb::ColumnDecoder<qint64>::read(column, data, row));
+        break;
+    case Double:
+        write<double>(gadget, QDuckdb::ColumnDecoder<double>::read(column, data, row));
+        break;
+    case Bool:
+        write<bool>(gadget, QDuckdb::ColumnDecoder<bool>::read(column, data, row));
+        break;
+    case String:
+        write<QString>(gadget, QDuckdb::ColumnDecoder<QString>::read(column, data, row));
+        break;
+    case ByteArray: {
+        // the chunk is released once read, the bytes are copied
+        const duckdb_string_t &str = static_cast<const duckdb_string_t *>(data)[row];
+        write<QByteArray>(gadget, QByteArray(QDuckdb::stringData(str), int(str.value.inlined.length)));
+        break;
+    }
+    case Date:
+        write<QDate>(gadget, QDuckdb::ColumnDecoder<QDate>::read(column, data, row));
+        break;
+    case DateTime:
+        write<QDateTime>(gadget, QDuckdb::ColumnDecoder<QDateTime>::read(column, data, row));
+        break;
+    default:
+        break;
+    }
+}
+
+static duckdb_hugeint qUuidToHugeint(const QUuid &uuid)
+{
+    const QByteArray bytes = uuid.toRfc4122();
+    return duckdb_hugeint{ qFromBigEndian<quint64>(bytes.constData() + 8),
+                           qFromBigEndian<qint64>(bytes.constData()) };
+}
+
+// DuckDB type of the LIST elements built from a Qt type
+static duckdb_type qListChildType(int type)
+{
+    switch (type) {
+    case QMetaType::Bool:
+        return DUCKDB_TYPE_BOOLEAN;
+    case QMetaType::Int:
+    case QMetaType::Short:
+    case QMetaType::Char:
+    case QMetaType::SChar:
+    case QMetaType::LongLong:
+    case QMetaType::Long:
+        return DUCKDB_TYPE_BIGINT;
+    case QMetaType::UInt:
+    case QMetaType::UShort:
+    case QMetaType::UChar:
+    case QMetaType::ULongLong:
+    case QMetaType::ULong:
+        return DUCKDB_TYPE_UBIGINT;
+    case QMetaType::Float:
+        return DUCKDB_TYPE_FLOAT;
+    case QMetaType::Double:
+        return DUCKDB_TYPE_DOUBLE;
+    case QMetaType::QDate:
+        return DUCKDB_TYPE_DATE;
+    case QMetaType::QTime:
+        return DUCKDB_TYPE_TIME;
+    case QMetaType::QDateTime:
+        return DUCKDB_TYPE_TIMESTAMP;
+    case QMetaType::QByteArray:
+        return DUCKDB_TYPE_BLOB;
+    default:
+        return DUCKDB_TYPE_VARCHAR;
+    }
+}
+
+// the type two list elements both convert to without loss, DUCKDB_TYPE_INVALID if there is none;
+// integers and floating point numbers have none, a DOUBLE rounds integers above 2^53
+static duckdb_type qCommonListType(duckdb_type a, duckdb_type b)
+{
+    if (a == b || a == DUCKDB_TYPE_INVALID)
+        return b;
+    const auto isInteger = [](duckdb_type type) {
+        return type == DUCKDB_TYPE_BIGINT || type == DUCKDB_TYPE_UBIGINT || type == DUCKDB_TYPE_HUGEINT;
+    };
+    const auto isFloating = [](duckdb_type type) {
+        return type == DUCKDB_TYPE_FLOAT || type == DUCKDB_TYPE_DOUBLE;
+    };
+    if (isInteger(a) && isInteger(b))
+        return DUCKDB_TYPE_HUGEINT;
+    if (isFloating(a) && isFloating(b))
+        return DUCKDB_TYPE_DOUBLE;
+    if ((a == DUCKDB_TYPE_DATE && b == DUCKDB_TYPE_TIMESTAMP) || (a == DUCKDB_TYPE_TIMESTAMP && b == DUCKDB_TYPE_DATE))
+        return DUCKDB_TYPE_TIMESTAMP;
+    return DUCKDB_TYPE_INVALID;
+}
+
+static duckdb_value qCreateValue(duckdb_type type, const QVariant &value)
+{
+    switch (type) {
+    case DUCKDB_TYPE_BOOLEAN:
+        return duckdb_create_bool(value.toBool());
+    case DUCKDB_TYPE_BIGINT:
+        return duckdb_create_int64(value.toLongLong());
+    case DUCKDB_TYPE_UBIGINT:
+        return duckdb_create_uint64(value.toULongLong());
+    case DUCKDB_TYPE_HUGEINT: {
+        if (qListChildType(value.userType()) == DUCKDB_TYPE_UBIGINT)
+            return duckdb_create_hugeint(duckdb_hugeint{ value.toULongLong(), 0 });
+        const qint64 v = value.toLongLong();
+        return duckdb_create_hugeint(duckdb_hugeint{ quint64(v), v < 0 ? -1 : 0 });
+    }
+    case DUCKDB_TYPE_FLOAT:
+        return duckdb_create_float(value.toFloat());
+    case DUCKDB_TYPE_DOUBLE:
+        return duckdb_create_double(value.toDouble());
+    case DUCKDB_TYPE_DATE:
+        return duckdb_create_date(duckdb_date{ int32_t(value.toDate().toJulianDay() - qJulianDayOfEpoch) });
+    case DUCKDB_TYPE_TIME:
+        return duckdb_create_time(duckdb_time{ value.toTime().msecsSinceStartOfDay() * qint64(1000) });
+    case DUCKDB_TYPE_TIMESTAMP:
+        if (value.userType() == QMetaType::QDate)
+            return duckdb_create_timestamp(duckdb_timestamp{ (value.toDate().toJulianDay() - qJulianDayOfEpoch) * 86400000000LL });
+        return duckdb_create_timestamp(duckdb_timestamp{ value.toDateTime().toMSecsSinceEpoch() * 1000 });
+    case DUCKDB_TYPE_BLOB: {
+        const QByteArray ba = value.toByteArray();
+        return duckdb_create_blob(reinterpret_cast<const uint8_t *>(ba.constData()), ba.size());
+    }
+    default: {
+        const QByteArray str = value.toString().toUtf8();
+        return duckdb_create_varchar_length(str.constData(), str.size());
+    }
+    }
+}
+
+/*
+   Binds a QVariantList, QStringList or QVector<T> as one LIST value, so that
+   "id = ANY(?)" keeps the same statement text whatever the number of ids. The
+   element type is the one all elements convert to without loss; elements
+   without such a type, like integers and doubles or numbers and strings, fail
+   the bind. NULL elements do not count towards the element type, but the C API
+   of DuckDB 1.1.3 cannot create a NULL value to put in the list, so they fail
+   the bind too. An empty list has no element type, and this DuckDB version
+   only reports LIST as the parameter type, so it binds as NULL[], which casts
+   to any list.
+*/
+static duckdb_state qBindList(duckdb_prepared_statement stmt, idx_t index, const QVariant &value)
+{
+    const QSequentialIterable iterable = value.value<QSequentialIterable>();
+    QVector<QVariant> elements;
+    elements.reserve(qMax(iterable.size(), 0));
+    duckdb_type childType = DUCKDB_TYPE_INVALID;
+    bool ok = true;
+    bool nulls = false;
+    for (const QVariant &element : iterable) {
+        elements.append(element);
+        if (element.isNull()) {
+            nulls = true;
+            continue;
+        }
+        childType = qCommonListType(childType, qListChildType(element.userType()));
+        if (childType == DUCKDB_TYPE_INVALID) {
+            ok = false;
+            break;
+        }
+    }
+    if (nulls)
+        ok = false;
+    if (elements.isEmpty())
+        childType = DUCKDB_TYPE_SQLNULL;
+
+    std::vector<duckdb_value> values;
+    if (ok) {
+        values.reserve(size_t(elements.size()));
+        for (const QVariant &element : qAsConst(elements))
+            values.push_back(qCreateValue(childType, element));
+    }
+
+    duckdb_state res = DuckDBError;
+    if (ok) {
+        duckdb_logical_type logicalType = duckdb_create_logical_type(childType);
+        // the elements must not be null even when there are none
+        duckdb_value none = nullptr;
+        duckdb_value list = duckdb_create_list_value(logicalType, values.empty() ? &none : values.data(),
+                                                     values.size());
+        if (list) {
+            res = duckdb_bind_value(stmt, index, list);
+            duckdb_destroy_value(&list);
+        }
+        duckdb_destroy_logical_type(&logicalType);
+    }
+    for (duckdb_value &element : values)
+        duckdb_destroy_value(&element);
+    return res;
+}
+
+// size of the reads and writes used to stream BLOBs from and to a QIODevice
+static const qint64 qBlobBufferSize = 1 << 20;
+// longest wait of a sequential device for more data to read, or for its written data to drain
+static const int qBlobDeviceTimeout = 30000;
+
+// DuckDB copies bound values, the mapping is only needed for the bind itself
+static duckdb_state qBindMappedFile(duckdb_prepared_statement stmt, idx_t index, QFileDevice *file, bool *mapped)
+{
+    const qint64 size = file->size() - file->pos();
+    *mapped = true;
+    if (size <= 0)
+        return duckdb_bind_blob(stmt, index, "", 0);
+    uchar *data = file->map(file->pos(), size);
+    if (!data) {
+        *mapped = false;
+        return DuckDBError;
+    }
+    const duckdb_state res = duckdb_bind_blob(stmt, index, data, idx_t(size));
+    file->unmap(data);
+    if (res == DuckDBSuccess)
+        file->seek(file->pos() + size);
+    return res;
+}
+
+/*
+   Binds the rest of device as a BLOB. A file is mapped and a QBuffer bound
+   from its own bytes; other devices are copied in bounded steps to a temporary
+   file that is mapped in turn, so no buffer of the size of the BLOB is built.
+   A sequential device ends when it has no more data to wait for, and fails the
+   bind when it stalls for longer than qBlobDeviceTimeout.
+*/
+static duckdb_state qBindDevice(duckdb_prepared_statement stmt, idx_t index, QIODevice *device)
+{
+    if (!device->isReadable())
+        return DuckDBError;
+
+    if (QFileDevice *file = qobject_cast<QFileDevice *>(device)) {
+        bool mapped;
+        const duckdb_state res = qBindMappedFile(stmt, index, file, &mapped);
+        if (mapped)
+            return res;
+    } else if (QBuffer *buffer = qobject_cast<QBuffer *>(device)) {
+        const QByteArray &bytes = buffer->data();
+        const qint64 pos = qMin<qint64>(buffer->pos(), bytes.size());
+        const duckdb_state res = duckdb_bind_blob(stmt, index, bytes.constData() + pos, idx_t(bytes.size() - pos));
+        if (res == DuckDBSuccess)
+            buffer->seek(bytes.size());
+        return res;
+    }
+
+    QTemporaryFile spool;
+    if (!spool.open())
+        return DuckDBError;
+    QByteArray chunk(int(qBlobBufferSize), Qt::Uninitialized);
+    QElapsedTimer idle;
+    idle.start();
+    for (;;) {
+        const qint64 read = device->read(chunk.data(), qBlobBufferSize);
+        if (read < 0)
+            return DuckDBError;
+        if (read > 0) {
+            if (spool.write(chunk.constData(), read) != read)
+                return DuckDBError;
+            idle.restart();
+            continue;
+        }
+        if (!device->isSequential())
+            break;
+        // nothing to read for now: the device ends unless waiting brings more, a read
+        // that keeps returning nothing without ending still runs into the timeout
+        const qint64 remaining = qBlobDeviceTimeout - idle.elapsed();
+        if (remaining <= 0)
+            return DuckDBError;
+        if (!device->waitForReadyRead(int(remaining))) {
+            if (idle.hasExpired(qBlobDeviceTimeout))
+                return DuckDBError;
+            break;
+        }
+    }
+    if (!spool.flush() || !spool.seek(0))
+        return DuckDBError;
+    bool mapped;
+    return qBindMappedFile(stmt, index, &spool, &mapped);
+}
+
+/*
+   Binds value with the DuckDB binder of its own type, so the statement does not
+   have to parse text. The parameter type, when the planner knows it, decides
+   between binders that take the same Qt type.
+*/
+static duckdb_state qBindValue(duckdb_prepared_statement stmt, idx_t index, const QVariant &value)
+{
+    if (value.isNull())
+        return duckdb_bind_null(stmt, index);
+
+    const duckdb_type paramType = duckdb_param_type(stmt, index);
+    switch (value.userType()) {
+    case QMetaType::Bool:
+        return duckdb_bind_boolean(stmt, index, value.toBool());
+    case QMetaType::Int:
+    case QMetaType::Short:
+    case QMetaType::Char:
+    case QMetaType::SChar:
+        // an INTEGER value unless the parameter is known to be wider, so untyped parameters stay INTEGER
+        if (paramType != DUCKDB_TYPE_BIGINT && paramType != DUCKDB_TYPE_HUGEINT)
+            return duckdb_bind_int32(stmt, index, value.toInt());
+        Q_FALLTHROUGH();
+    case QMetaType::LongLong:
+    case QMetaType::Long:
+        if (paramType == DUCKDB_TYPE_HUGEINT) {
+            const qint64 v = value.toLongLong();
+            return duckdb_bind_hugeint(stmt, index, duckdb_hugeint{ quint64(v), v < 0 ? -1 : 0 });
+        }
+        return duckdb_bind_int64(stmt, index, value.toLongLong());
+    case QMetaType::UInt:
+    case QMetaType::UShort:
+    case QMetaType::UChar:
+        if (paramType != DUCKDB_TYPE_UBIGINT && paramType != DUCKDB_TYPE_HUGEINT)
+            return duckdb_bind_uint32(stmt, index, value.toUInt());
+        Q_FALLTHROUGH();
+    case QMetaType::ULongLong:
+    case QMetaType::ULong:
+        if (paramType == DUCKDB_TYPE_HUGEINT)
+            return duckdb_bind_hugeint(stmt, index, duckdb_hugeint{ value.toULongLong(), 0 });
+        return duckdb_bind_uint64(stmt, index, value.toULongLong());
+    case QMetaType::Float:
+        return duckdb_bind_float(stmt, index, value.toFloat());
+    case QMetaType::Double:
+        if (paramType == DUCKDB_TYPE_FLOAT)
+            return duckdb_bind_float(stmt, index, value.toFloat());
+        return duckdb_bind_double(stmt, index, value.toDouble());
+    case QMetaType::QDate: {
+        const QDate date = value.toDate();
+        if (paramType == DUCKDB_TYPE_TIMESTAMP || paramType == DUCKDB_TYPE_TIMESTAMP_TZ)
+            return duckdb_bind_timestamp(stmt, index,
+                                         duckdb_timestamp{ (date.toJulianDay() - qJulianDayOfEpoch) * 86400000000LL });
+        return duckdb_bind_date(stmt, index, duckdb_date{ int32_t(date.toJulianDay() - qJulianDayOfEpoch) });
+    }
+    case QMetaType::QTime:
+        return duckdb_bind_time(stmt, index, duckdb_time{ value.toTime().msecsSinceStartOfDay() * qint64(1000) });
+    case QMetaType::QDateTime: {
+        // TIMESTAMP holds the UTC instant, the same convention the appender and the fetch use
+        const QDateTime dateTime = value.toDateTime();
+        const duckdb_timestamp ts{ dateTime.toMSecsSinceEpoch() * 1000 };
+        if (paramType == DUCKDB_TYPE_TIMESTAMP_TZ
+                || (paramType != DUCKDB_TYPE_TIMESTAMP && dateTime.timeSpec() != Qt::LocalTime
+                    && dateTime.timeSpec() != Qt::UTC))
+            return duckdb_bind_timestamp_tz(stmt, index, ts);
+        if (paramType == DUCKDB_TYPE_DATE)
+            return duckdb_bind_date(stmt, index,
+                                    duckdb_date{ int32_t(dateTime.toUTC().date().toJulianDay() - qJulianDayOfEpoch) });
+        return duckdb_bind_timestamp(stmt, index, ts);
+    }
+    case QMetaType::QByteArray: {
+        const QByteArray *ba = static_cast<const QByteArray*>(value.constData());
+        if (paramType == DUCKDB_TYPE_VARCHAR)
+            return duckdb_bind_varchar_length(stmt, index, ba->constData(), ba->size());
+        return duckdb_bind_blob(stmt, index, ba->constData(), ba->size());
+    }
+    case QMetaType::QUuid: {
+        const QUuid uuid = value.toUuid();
+        if (paramType == DUCKDB_TYPE_HUGEINT)
+            return duckdb_bind_hugeint(stmt, index, qUuidToHugeint(uuid));
+        // the C API of this DuckDB version has no UUID value, the canonical form is cast without ambiguity
+        const QByteArray str = uuid.toByteArray(QUuid::WithoutBraces);
+        return duckdb_bind_varchar_length(stmt, index, str.constData(), str.size());
+    }
+    case QMetaType::QString: {
+        const QByteArray str = static_cast<const QString *>(value.constData())->toUtf8();
+        return duckdb_bind_varchar_length(stmt, index, str.constData(), str.size());
+    }
+    case QMetaType::QVariantList:
+    case QMetaType::QStringList:
+        return qBindList(stmt, index, value);
+    default: {
+        if (QIODevice *device = qobject_cast<QIODevice *>(value.value<QObject *>()))
+            return qBindDevice(stmt, index, device);
+        if (value.canConvert<QVariantList>())
+            return qBindList(stmt, index, value);
+        const QByteArray str = value.toString().toUtf8();
+        return duckdb_bind_varchar_length(stmt, index, str.constData(), str.size());
+    }
+    }
+}
+
+/*
+   Runs statement index of query again with the values it was bound to, when a
+   grouped transaction is rebuilt without one of its members. A device was read
+   by the first run, such a write cannot be replayed.
+*/
+static bool qReplayStatement(duckdb_connection connection, const QByteArray &query, idx_t index,
+                             const QVector<QVariant> &values)
+{
+    for (const QVariant &value : values) {
+        if (qobject_cast<QIODevice *>(value.value<QObject *>()))
+            return false;
+    }
+    duckdb_extracted_statements extracted = nullptr;
+    if (duckdb_extract_statements(connection, query.constData(), &extracted) <= index) {
+        duckdb_destroy_extracted(&extracted);
+        return false;
+    }
+    duckdb_prepared_statement stmt;
+    bool ok = duckdb_prepare_extracted_statement(connection, extracted, index, &stmt) == DuckDBSuccess;
+    for (int i = 0; ok && i < values.size(); ++i)
+        ok = qBindValue(stmt, idx_t(i) + 1, values.at(i)) == DuckDBSuccess;
+    if (ok) {
+        duckdb_result result;
+        ok = duckdb_execute_prepared(stmt, &result) == DuckDBSuccess;
+        duckdb_destroy_result(&result);
+    }
+    duckdb_destroy_prepare(&stmt);
+    duckdb_destroy_extracted(&extracted);
+    return ok;
+}
+
+// private_data of the ArrowSchema trees the driver builds, owning their strings and children
+struct QDuckdbArrowSchemaData
+{
+    QByteArray format;
+    QByteArray name;
+    QVector<ArrowSchema *> children;
+    ArrowSchema *dictionary = nullptr;
+};
+
+static void qArrowSchemaRelease(ArrowSchema *schema)
+{
+    QDuckdbArrowSchemaData *data = static_cast<QDuckdbArrowSchemaData *>(schema->private_data);
+    for (ArrowSchema *child : qAsConst(data->children)) {
+        if (child->release)
+            child->release(child);
+        delete child;
+    }
+    if (data->dictionary) {
+        if (data->dictionary->release)
+            data->dictionary->release(data->dictionary);
+        delete data->dictionary;
+    }
+    delete data;
+    schema->private_data = nullptr;
+    schema->release = nullptr;
+}
+
+static QDuckdbArrowSchemaData *qInitArrowSchema(ArrowSchema *schema, const QByteArray &format,
+                                                const QByteArray &name, int64_t flags)
+{
+    QDuckdbArrowSchemaData *data = new QDuckdbArrowSchemaData;
+    data->format = format;
+    data->name = name;
+    schema->format = data->format.constData();
+    schema->name = data->name.constData();
+    schema->metadata = nullptr;
+    schema->flags = flags;
+    schema->n_children = 0;
+    schema->children = nullptr;
+    schema->dictionary = nullptr;
+    schema->release = qArrowSchemaRelease;
+    schema->private_data = data;
+    return data;
+}
+
+// publishes the children appended to the private data
+static void qFinishArrowSchema(ArrowSchema *schema)
+{
+    QDuckdbArrowSchemaData *data = static_cast<QDuckdbArrowSchemaData *>(schema->private_data);
+    schema->n_children = data->children.size();
+    schema->children = data->children.isEmpty() ? nullptr : data->children.data();
+    schema->dictionary = data->dictionary;
+}
+
+static bool qArrowSchemaFromType(duckdb_logical_type type, const QByteArray &name,
+                                 const QByteArray &timeZone, ArrowSchema *out);
+
+// takes ownership of type
+static ArrowSchema *qAppendArrowChild(QDuckdbArrowSchemaData *parent, duckdb_logical_type type,
+                                      const QByteArray &name, const QByteArray &timeZone)
+{
+    ArrowSchema *child = new ArrowSchema;
+    child->release = nullptr;
+    parent->children.append(child);
+    const bool ok = qArrowSchemaFromType(type, name, timeZone, child);
+    duckdb_destroy_logical_type(&type);
+    return ok ? child : nullptr;
+}
+
+/*
+   Describes a DuckDB type the way duckdb_result_arrow_array() lays out its
+   arrays with the default Arrow settings: 32-bit offsets, UUIDs as strings,
+   HUGEINTs as 38 digit decimals and ENUMs dictionary encoded. The C API only
+   exports the schema of the parameters of a prepared statement, so the schema
+   of a result is built here. Returns false for types without an Arrow layout.
+*/
+static bool qArrowSchemaFromType(duckdb_logical_type type, const QByteArray &name,
+                                 const QByteArray &timeZone, ArrowSchema *out)
+{
+    QByteArray format;
+    const duckdb_type id = duckdb_get_type_id(type);
+    switch (id) {
+    case DUCKDB_TYPE_SQLNULL: format = QByteArrayLiteral("n"); break;
+    case DUCKDB_TYPE_BOOLEAN: format = QByteArrayLiteral("b"); break;
+    case DUCKDB_TYPE_TINYINT: format = QByteArrayLiteral("c"); break;
+    case DUCKDB_TYPE_SMALLINT: format = QByteArrayLiteral("s"); break;
+    case DUCKDB_TYPE_INTEGER: format = QByteArrayLiteral("i"); break;
+    case DUCKDB_TYPE_BIGINT: format = QByteArrayLiteral("l"); break;
+    case DUCKDB_TYPE_UTINYINT: format = QByteArrayLiteral("C"); break;
+    case DUCKDB_TYPE_USMALLINT: format = QByteArrayLiteral("S"); break;
+    case DUCKDB_TYPE_UINTEGER: format = QByteArrayLiteral("I"); break;
+    case DUCKDB_TYPE_UBIGINT: format = QByteArrayLiteral("L"); break;
+    case DUCKDB_TYPE_HUGEINT:
+    case DUCKDB_TYPE_UHUGEINT: format = QByteArrayLiteral("d:38,0"); break;
+    case DUCKDB_TYPE_FLOAT: format = QByteArrayLiteral("f"); break;
+    case DUCKDB_TYPE_DOUBLE: format = QByteArrayLiteral("g"); break;
+    case DUCKDB_TYPE_DECIMAL:
+        format = "d:" + QByteArray::number(duckdb_decimal_width(type)) + ','
+                + QByteArray::number(duckdb_decimal_scale(type));
+        break;
+    case DUCKDB_TYPE_VARCHAR:
+    case DUCKDB_TYPE_UUID: format = QByteArrayLiteral("u"); break;
+    case DUCKDB_TYPE_BLOB: format = QByteArrayLiteral("z"); break;
+    case DUCKDB_TYPE_DATE: format = QByteArrayLiteral("tdD"); break;
+    case DUCKDB_TYPE_TIME:
+    case DUCKDB_TYPE_TIME_TZ: format = QByteArrayLiteral("ttu"); break;
+    case DUCKDB_TYPE_TIMESTAMP: format = QByteArrayLiteral("tsu:"); break;
+    case DUCKDB_TYPE_TIMESTAMP_S: format = QByteArrayLiteral("tss:"); break;
+    case DUCKDB_TYPE_TIMESTAMP_MS: format = QByteArrayLiteral("tsm:"); break;
+    case DUCKDB_TYPE_TIMESTAMP_NS: format = QByteArrayLiteral("tsn:"); break;
+    case DUCKDB_TYPE_TIMESTAMP_TZ: format = "tsu:" + timeZone; break;
+    case DUCKDB_TYPE_INTERVAL: format = QByteArrayLiteral("tin"); break;
+    case DUCKDB_TYPE_ENUM:
+        // the indexes, the dictionary holds the values
+        switch (duckdb_enum_internal_type(type)) {
+        case DUCKDB_TYPE_UTINYINT: format = QByteArrayLiteral("C"); break;
+        case DUCKDB_TYPE_USMALLINT: format = QByteArrayLiteral("S"); break;
+        default: format = QByteArrayLiteral("I"); break;
+        }
+        break;
+    case DUCKDB_TYPE_LIST: format = QByteArrayLiteral("+l"); break;
+    case DUCKDB_TYPE_ARRAY: format = "+w:" + QByteArray::number(quint64(duckdb_array_type_array_size(type))); break;
+    case DUCKDB_TYPE_STRUCT: format = QByteArrayLiteral("+s"); break;
+    case DUCKDB_TYPE_MAP: format = QByteArrayLiteral("+m"); break;
+    case DUCKDB_TYPE_UNION: {
+        format = QByteArrayLiteral("+us:");
+        const idx_t members = duckdb_union_type_member_count(type);
+        for (idx_t i = 0; i < members; ++i)
+            format += (i ? "," : "") + QByteArray::number(quint64(i));
+        break;
+    }
+    default:
+        return false;
+    }
+
+    QDuckdbArrowSchemaData *data = qInitArrowSchema(out, format, name, ARROW_FLAG_NULLABLE);
+    bool ok = true;
+    switch (id) {
+    case DUCKDB_TYPE_ENUM:
+        data->dictionary = new ArrowSchema;
+        qInitArrowSchema(data->dictionary, QByteArrayLiteral("u"), QByteArray(), ARROW_FLAG_NULLABLE);
+        break;
+    case DUCKDB_TYPE_LIST:
+        ok = qAppendArrowChild(data, duckdb_list_type_child_type(type), QByteArrayLiteral("l"), timeZone);
+        break;
+    case DUCKDB_TYPE_ARRAY:
+        ok = qAppendArrowChild(data, duckdb_array_type_child_type(type), QByteArrayLiteral("l"), timeZone);
+        break;
+    case DUCKDB_TYPE_STRUCT:
+        for (idx_t i = 0; ok && i < duckdb_struct_type_child_count(type); ++i) {
+            char *childName = duckdb_struct_type_child_name(type, i);
+            ok = qAppendArrowChild(data, duckdb_struct_type_child_type(type, i), childName, timeZone);
+            duckdb_free(childName);
+        }
+        break;
+    case DUCKDB_TYPE_UNION:
+        for (idx_t i = 0; ok && i < duckdb_union_type_member_count(type); ++i) {
+            char *memberName = duckdb_union_type_member_name(type, i);
+            ok = qAppendArrowChild(data, duckdb_union_type_member_type(type, i), memberName, timeZone);
+            duckdb_free(memberName);
+        }
+        break;
+    case DUCKDB_TYPE_MAP: {
+        // a list of non-null key/value structs
+        ArrowSchema *entries = new ArrowSchema;
+        data->children.append(entries);
+        QDuckdbArrowSchemaData *entriesData = qInitArrowSchema(entries, QByteArrayLiteral("+s"),
+                                                               QByteArrayLiteral("entries"), 0);
+        ArrowSchema *key = qAppendArrowChild(entriesData, duckdb_map_type_key_type(type),
+                                             QByteArrayLiteral("key"), timeZone);
+        if (key)
+            key->flags = 0;
+        ok = key && qAppendArrowChild(entriesData, duckdb_map_type_value_type(type),
+                                      QByteArrayLiteral("value"), timeZone);
+        qFinishArrowSchema(entries);
+        break;
+    }
+    default:
+        break;
+    }
+    qFinishArrowSchema(out);
+    if (!ok)
+        out->release(out);
+    return ok;
+}
+
+// the schema of the arrays duckdb_result_arrow_array() produces for result
+static bool qArrowSchemaFromResult(duckdb_result *result, const QByteArray &timeZone, ArrowSchema *out)
+{
+    QDuckdbArrowSchemaData *data = qInitArrowSchema(out, QByteArrayLiteral("+s"),
+                                                    QByteArrayLiteral("duckdb_query_result"), 0);
+    bool ok = true;
+    const idx_t count = duckdb_column_count(result);
+    for (idx_t i = 0; ok && i < count; ++i)
+        ok = qAppendArrowChild(data, duckdb_column_logical_type(result, i), duckdb_column_name(result, i), timeZone);
+    qFinishArrowSchema(out);
+    if (!ok)
+        out->release(out);
+    return ok;
+}
+
+// private_data of the ArrowArrayStream handed out by QDuckdbResult::exportArrowStream()
+struct QDuckdbArrowStream
+{
+    duckdb_result *result;
+    QByteArray timeZone;
+    idx_t chunk;
+    QByteArray lastError;
+};
+
+static int qArrowStreamGetSchema(ArrowArrayStream *stream, ArrowSchema *out)
+{
+    QDuckdbArrowStream *priv = static_cast<QDuckdbArrowStream *>(stream->private_data);
+    if (!qArrowSchemaFromResult(priv->result, priv->timeZone, out)) {
+        priv->lastError = QByteArrayLiteral("Unable to describe the result columns");
+        return EINVAL;
+    }
+    return 0;
+}
+
+static int qArrowStreamGetNext(ArrowArrayStream *stream, ArrowArray *out)
+{
+    QDuckdbArrowStream *priv = static_cast<QDuckdbArrowStream *>(stream->private_data);
+    if (priv->chunk >= duckdb_result_chunk_count(*priv->result)) {
+        // end of stream
+        out->release = nullptr;
+        return 0;
+    }
+    duckdb_data_chunk chunk = duckdb_result_get_chunk(*priv->result, priv->chunk++);
+    if (!chunk) {
+        priv->lastError = QByteArrayLiteral("Unable to fetch the result chunk");
+        return EIO;
+    }
+    duckdb_arrow_array array = reinterpret_cast<duckdb_arrow_array>(out);
+    duckdb_result_arrow_array(*priv->result, chunk, &array);
+    duckdb_destroy_data_chunk(&chunk);
+    return 0;
+}
+
+static const char *qArrowStreamGetLastError(ArrowArrayStream *stream)
+{
+    QDuckdbArrowStream *priv = static_cast<QDuckdbArrowStream *>(stream->private_data);
+    return priv->lastError.isEmpty() ? nullptr : priv->lastError.constData();
+}
+
+static void qArrowStreamRelease(ArrowArrayStream *stream)
+{
+    delete static_cast<QDuckdbArrowStream *>(stream->private_data);
+    stream->private_data = nullptr;
+    stream->release = nullptr;
+}
+
+// what a TRANSACTION statement does, the C API only classifies it as a transaction statement
+enum QDuckdbTransactionStep
+{
+    QDuckdbNoTransactionStep,
+    QDuckdbBeginStep,
+    QDuckdbCommitStep,
+    QDuckdbRollbackStep
+};
+
+class QDuckdbDriverPrivate : public QSqlDriverPrivate, public QDuckdbChangeListener
+{
+    Q_DECLARE_PUBLIC(QDuckdbDriver)
+
+public:
+    inline QDuckdbDriverPrivate() : QSqlDriverPrivate(QSqlDriver::SQLite) {
+        conn=ownConn=new duckdb_connection;
+    }
+    ~QDuckdbDriverPrivate() { delete ownConn; }
+    // shared with the other connections to the same file
+    QDuckdbDatabase *database=nullptr;
+    // the connection statements run on, the one of the commit group during a grouped transaction
+    duckdb_connection  *conn=nullptr;
+    duckdb_connection  *ownConn=nullptr;
+    duckdb_prepared_statement stmt;
+    QVector<QDuckdbResult *> results;
+    QStringList notificationid;
+    // Change notifications: the rows changed per subscribed table since it was last notified,
+    // which is at most once per notificationInterval (QDUCKDB_NOTIFY_INTERVAL) ms.
+    struct PendingNotification
+    {
+        qint64 rows = 0;
+        bool self = false;
+        bool other = false;
+    };
+    void tableChanged(const QString &table, qint64 rows, bool self) override;
+    // a change made through this connection, held back until the commit inside a transaction
+    void recordChange(const QString &table, qint64 rows);
+    QMutex notificationMutex;
+    QHash<QString, PendingNotification> pendingNotifications;
+    QHash<QString, qint64> lastNotified;
+    QElapsedTimer notificationClock;
+    int notificationInterval = 100;
+    bool notificationScheduled = false;
+    // the catalog of unqualified subscribed and changed table names
+    QString notificationCatalog;
+    // set by beginTransaction() and by BEGIN run as SQL
+    bool inTransaction = false;
+    QHash<QString, qint64> transactionChanges;
+    void endTransaction(bool committed);
+    // Gadget property index per column, keyed by gadget type and column names or table.
+    // The mappings are dropped after DDL and once there are gadgetColumnsLimit of them.
+    bool cachedGadgetColumns(const QMetaObject *metaObject, const QString &key,
+                             QVector<QDuckdbGadgetProperty> *properties);
+    void cacheGadgetColumns(const QMetaObject *metaObject, const QString &key,
+                            const QVector<QDuckdbGadgetProperty> &properties);
+    static const int gadgetColumnsLimit = 256;
+    QHash<QPair<const QMetaObject *, QString>, QVector<QDuckdbGadgetProperty>> gadgetColumns;
+    quint64 gadgetColumnsVersion = 0;
+
+    // the TimeZone setting of the connection, TIMESTAMP WITH TIME ZONE values are shown in it
+    QTimeZone sessionTimeZone();
+    QByteArray timeZoneId;
+    QTimeZone timeZone;
+    // QDUCKDB_ZERO_COPY_BLOBS
+    bool zeroCopyBlobs = false;
+    // QDUCKDB_INTERN_STRINGS
+    bool internStrings = false;
+    // QDUCKDB_GROUP_COMMIT, in milliseconds
+    int groupCommitWindow = 0;
+    // QDUCKDB_BUSY_TIMEOUT, in milliseconds, how long a grouped commit waits for the rest of its group
+    int busyTimeout = 5000;
+    QSharedPointer<QDuckdbCommitGroup> commitGroup;
+    int commitMember = 0;
+    bool leaveCommitGroup(bool commit, QString *error);
+    // the members of a group take turns on its connection, a connection of its own needs no lock
+    QRecursiveMutex *connectionMutex() { return commitGroup ? &commitGroup->statementMutex : nullptr; }
+    // false once the grouped transaction dropped this member, its statements then fail
+    bool commitMemberActive();
+    // a write of the grouped transaction, replayed when another member is dropped
+    void logGroupStatement(const QByteArray &query, idx_t index, const QVector<QVariant> &values);
+    // a failed statement aborts the transaction, in a group only the writes of this member are lost
+    void statementFailed();
+    // the kind of the last statement failure, runTransaction() retries on conflicts
+    duckdb_error_type lastErrorType = DUCKDB_ERROR_INVALID;
+    quint64 transactionRetries = 0;
+    quint64 transactionAborts = 0;
+
+    // drops the schema caches after DDL, again at the end of its transaction for the other connections
+    void statementExecuted(duckdb_statement_type type, QDuckdbTransactionStep step = QDuckdbNoTransactionStep);
+    // DDL of the open transaction, only this connection sees it, so the shared cache is bypassed
+    bool schemaChanged = false;
+    // temporary tables and views are private to the connection, they shadow the database cache
+    void refreshTemporaryTables();
+    QDuckdbTableInfo tableInfo(const QString &table);
+    QStringList tableNames(QSql::TableType type);
+    bool temporaryLoaded = false;
+    quint64 temporaryVersion = 0;
+    QStringList temporaryTables;
+    QStringList temporaryViews;
+    QHash<QString, QDuckdbTableInfo> temporaryInfo;
+
+    // registerArrowIpcFile(): the mapped files behind the views of this connection, keyed by
+    // view name; their streams are read once per scan, so each statement starts them over
+    struct ArrowIpcView
+    {
+        explicit ArrowIpcView(const QString &fileName) : file(fileName) {}
+        QDuckdbArrowIpcFile file;
+        ArrowArrayStream stream;
+    };
+    QHash<QString, QSharedPointer<ArrowIpcView>> arrowIpcViews;
+    void rewindArrowIpcViews();
+};
+
+/*
+   The setting is read for every result with a TIMESTAMP_TZ column since SET
+   TimeZone may change it, but the QTimeZone, whose construction is the costly
+   part, is only rebuilt when the name changes.
+*/
+QTimeZone QDuckdbDriverPrivate::sessionTimeZone()
+{
+    QByteArray id;
+    duckdb_result result;
+    QMutexLocker lock(connectionMutex());
+    if (duckdb_query(*conn, "SELECT current_setting('TimeZone')", &result) == DuckDBSuccess) {
+        duckdb_data_chunk chunk = duckdb_result_get_chunk(result, 0);
+        if (chunk) {
+            duckdb_vector vector = duckdb_data_chunk_get_vector(chunk, 0);
+            if (duckdb_data_chunk_get_size(chunk) > 0 && duckdb_validity_row_is_valid(duckdb_vector_get_validity(vector), 0)) {
+                const duckdb_string_t &str = static_cast<const duckdb_string_t *>(duckdb_vector_get_data(vector))[0];
+                id = QByteArray(QDuckdb::stringData(str), int(str.value.inlined.length));
+            }
+            duckdb_destroy_data_chunk(&chunk);
+        }
+    }
+    duckdb_destroy_result(&result);
+    lock.unlock();
+
+    if (id.isEmpty())
+        id = QByteArrayLiteral("UTC");
+    if (id != timeZoneId || !timeZone.isValid()) {
+        timeZoneId = id;
+        timeZone = QTimeZone(id);
+        if (!timeZone.isValid())
+            timeZone = QTimeZone::utc();
+    }
+    return timeZone;
+}
+
+bool QDuckdbDriverPrivate::cachedGadgetColumns(const QMetaObject *metaObject, const QString &key,
+                                               QVector<QDuckdbGadgetProperty> *properties)
+{
+    const quint64 version = database ? database->schemaVersion() : 0;
+    if (version != gadgetColumnsVersion) {
+        gadgetColumns.clear();
+        gadgetColumnsVersion = version;
+        return false;
+    }
+    const auto it = gadgetColumns.constFind(qMakePair(metaObject, key));
+    if (it == gadgetColumns.constEnd())
+        return false;
+    *properties = it.value();
+    return true;
+}
+
+void QDuckdbDriverPrivate::cacheGadgetColumns(const QMetaObject *metaObject, const QString &key,
+                                              const QVector<QDuckdbGadgetProperty> &properties)
+{
+    if (gadgetColumns.size() >= gadgetColumnsLimit)
+        gadgetColumns.clear();
+    gadgetColumns.insert(qMakePair(metaObject, key), properties);
+}
+
+bool QDuckdbDriverPrivate::leaveCommitGroup(bool commit, QString *error)
+{
+    const QSharedPointer<QDuckdbCommitGroup> group = commitGroup;
+    commitGroup.reset();
+    conn = ownConn;
+    const bool ok = database->finishCommitGroup(group, commitMember, commit, busyTimeout, error);
+    statementExecuted(DUCKDB_STATEMENT_TYPE_TRANSACTION);
+    endTransaction(commit && ok);
+    return ok;
+}
+
+// the writes of a grouped transaction are replayed when a member is dropped, not every write can be
+static const char qGroupedTransactionError[] = "not supported inside a grouped transaction";
+static const char qGroupedTransactionDropped[] = "the transaction was dropped from its commit group";
+
+void QDuckdbDriverPrivate::rewindArrowIpcViews()
+{
+    for (const QSharedPointer<ArrowIpcView> &view : qAsConst(arrowIpcViews))
+        view->file.rewind();
+}
+
+bool QDuckdbDriverPrivate::commitMemberActive()
+{
+    return !commitGroup || database->commitGroupMemberActive(commitGroup, commitMember);
+}
+
+void QDuckdbDriverPrivate::logGroupStatement(const QByteArray &query, idx_t index, const QVector<QVariant> &values)
+{
+    if (!commitGroup)
+        return;
+    commitGroup->statements.append({ commitMember, [query, index, values](duckdb_connection connection) {
+        return qReplayStatement(connection, query, index, values);
+    } });
+}
+
+void QDuckdbDriverPrivate::statementFailed()
+{
+    if (commitGroup)
+        database->dropCommitGroupMember(commitGroup, commitMember);
+}
+
+void QDuckdbDriverPrivate::recordChange(const QString &table, qint64 rows)
+{
+    if (!database || table.isEmpty() || !database->hasListeners())
+        return;
+    if (inTransaction)
+        transactionChanges[table] += rows;
+    else
+        database->notifyChange(table, rows, this);
+}
+
+void QDuckdbDriverPrivate::endTransaction(bool committed)
+{
+    inTransaction = false;
+    if (committed && database) {
+        for (auto it = transactionChanges.cbegin(); it != transactionChanges.cend(); ++it)
+            database->notifyChange(it.key(), it.value(), this);
+    }
+    transactionChanges.clear();
+}
+
+// the parts of a possibly qualified table name, without their quotes
+static QStringList qSplitTableName(const QString &name)
+{
+    QStringList parts;
+    QString part;
+    bool quoted = false;
+    for (int i = 0; i < name.size(); ++i) {
+        const QChar c = name.at(i);
+        if (c == QLatin1Char('"')) {
+            if (quoted && i + 1 < name.size() && name.at(i + 1) == QLatin1Char('"'))
+                part += name.at(++i);
+            else
+                quoted = !quoted;
+        } else if (c == QLatin1Char('.') && !quoted) {
+            parts.append(part);
+            part.clear();
+        } else {
+            part += c;
+        }
+    }
+    parts.append(part);
+    return parts;
+}
+
+/*
+   Whether the table names a and b, either of them qualified or not, name the
+   same table; unqualified names are in the main schema of catalog. A name of
+   two parts is schema.table, or catalog.table as DuckDB also resolves it.
+*/
+static bool qSameTable(const QString &a, const QString &b, const QString &catalog)
+{
+    const auto candidates = [&catalog](const QString &name) {
+        const QStringList parts = qSplitTableName(name);
+        QVector<QStringList> full;
+        if (parts.size() == 1)
+            full.append({ catalog, QStringLiteral("main"), parts.at(0) });
+        else if (parts.size() == 2)
+            full << QStringList{ catalog, parts.at(0), parts.at(1) } << QStringList{ parts.at(0), QStringLiteral("main"), parts.at(1) };
+        else
+            full.append(parts.mid(parts.size() - 3));
+        return full;
+    };
+    const auto equal = [](const QStringList &x, const QStringList &y) {
+        for (int i = 0; i < 3; ++i) {
+            if (x.at(i).compare(y.at(i), Qt::CaseInsensitive) != 0)
+                return false;
+        }
+        return true;
+    };
+    const QVector<QStringList> left = candidates(a);
+    const QVector<QStringList> right = candidates(b);
+    for (const QStringList &x : left) {
+        for (const QStringList &y : right) {
+            if (equal(x, y))
+                return true;
+        }
+    }
+    return false;
+}
+
+/*
+   Runs on the thread of whichever connection made the change, so it only
+   collects it; the notifications are emitted from the driver's own thread.
+*/
+void QDuckdbDriverPrivate::tableChanged(const QString &table, qint64 rows, bool self)
+{
+    Q_Q(QDuckdbDriver);
+    QMutexLocker locker(&notificationMutex);
+    const auto subscribed = std::find_if(notificationid.cbegin(), notificationid.cend(), [this, &table](const QString &name) {
+        return qSameTable(name, table, notificationCatalog);
+    });
+    if (subscribed == notificationid.cend())
+        return;
+    PendingNotification &pending = pendingNotifications[*subscribed];
+    pending.rows += rows;
+    (self ? pending.self : pending.other) = true;
+    if (!notificationScheduled) {
+        notificationScheduled = true;
+        QMetaObject::invokeMethod(q, "emitNotifications", Qt::QueuedConnection);
+    }
+}
+
+void QDuckdbDriverPrivate::statementExecuted(duckdb_statement_type type, QDuckdbTransactionStep step)
+{
+    if (!database)
+        return;
+    database->noteActivity();
+    switch (type) {
+    case DUCKDB_STATEMENT_TYPE_CREATE:
+    case DUCKDB_STATEMENT_TYPE_ALTER:
+    case DUCKDB_STATEMENT_TYPE_DROP:
+    case DUCKDB_STATEMENT_TYPE_ATTACH:
+    case DUCKDB_STATEMENT_TYPE_DETACH:
+        database->invalidateSchema();
+        schemaChanged = inTransaction;
+        break;
+    case DUCKDB_STATEMENT_TYPE_TRANSACTION:
+        // the other connections only see the DDL of a transaction once it ends
+        if (schemaChanged) {
+            database->invalidateSchema();
+            schemaChanged = false;
+        }
+        // BEGIN, COMMIT and ROLLBACK run as SQL are followed like beginTransaction() and the others
+        if (step == QDuckdbBeginStep)
+            inTransaction = true;
+        else if (step != QDuckdbNoTransactionStep)
+            endTransaction(step == QDuckdbCommitStep);
+        break;
+    default:
+        break;
+    }
+}
+
+struct QDuckdbSqlToken
+{
+    QString text;
+    bool quoted;
+};
+
+// the table written by the statement of tokens, the names and parentheses outside of any parentheses,
+// with its qualification
+static QString qChangedTable(const QVector<QDuckdbSqlToken> &tokens)
+{
+    const auto keyword = [&tokens](int i, const char *word) {
+        return i < tokens.size() && !tokens.at(i).quoted
+                && tokens.at(i).text.compare(QLatin1String(word), Qt::CaseInsensitive) == 0;
+    };
+    // the parts are quoted again, so that qSplitTableName() gets them back even if they contain dots
+    const auto name = [&tokens, &keyword](int *i) {
+        QStringList parts;
+        while (*i < tokens.size() && (tokens.at(*i).quoted || !keyword(*i, "("))) {
+            QString part = tokens.at(*i).text;
+            parts.append(QLatin1Char('"') + part.replace(QLatin1Char('"'), QLatin1String("\"\"")) + QLatin1Char('"'));
+            if (!keyword(*i + 1, "."))
+                break;
+            *i += 2;
+        }
+        ++*i;
+        return parts.join(QLatin1Char('.'));
+    };
+
+    // common table expressions come first, their queries are in parentheses
+    int i = 0;
+    while (i < tokens.size() && !keyword(i, "INSERT") && !keyword(i, "UPDATE") && !keyword(i, "DELETE")
+           && !keyword(i, "COPY"))
+        ++i;
+    if (keyword(i, "INSERT")) {
+        ++i;
+        if (keyword(i, "OR"))
+            i += 2;
+        return keyword(i, "INTO") ? (++i, name(&i)) : QString();
+    }
+    if (keyword(i, "UPDATE"))
+        return (++i, name(&i));
+    if (keyword(i, "DELETE"))
+        return keyword(++i, "FROM") ? (++i, name(&i)) : QString();
+    if (keyword(i, "COPY")) {
+        // COPY (query) TO and COPY table TO export, only COPY table FROM imports
+        ++i;
+        const QString table = keyword(i, "(") ? QString() : name(&i);
+        if (keyword(i, "("))
+            ++i;
+        return keyword(i, "FROM") ? table : QString();
+    }
+    return QString();
+}
+
+// the step of the transaction statement of tokens
+static QDuckdbTransactionStep qTransactionStep(const QVector<QDuckdbSqlToken> &tokens)
+{
+    if (tokens.isEmpty() || tokens.first().quoted)
+        return QDuckdbNoTransactionStep;
+    const QString &word = tokens.first().text;
+    const auto is = [&word](const char *keyword) { return word.compare(QLatin1String(keyword), Qt::CaseInsensitive) == 0; };
+    if (is("BEGIN") || is("START"))
+        return QDuckdbBeginStep;
+    if (is("COMMIT") || is("END"))
+        return QDuckdbCommitStep;
+    if (is("ROLLBACK") || is("ABORT"))
+        return QDuckdbRollbackStep;
+    return QDuckdbNoTransactionStep;
+}
+
+/*
+   Calls statement with the tokens of each statement of sql; the C API does not
+   tell which tables a statement is bound to or what a transaction statement
+   does. Literals and comments are skipped, only names and parentheses outside
+   of any parentheses are kept.
+*/
+static void qScanStatements(const QString &sql, const std::function<void(const QVector<QDuckdbSqlToken> &)> &statement)
+{
+    QVector<QDuckdbSqlToken> tokens;
+    bool inStatement = false;
+    int depth = 0;
+    const int size = sql.size();
+    const auto isNameChar = [](QChar c) { return c.isLetterOrNumber() || c == QLatin1Char('_') || c == QLatin1Char('$'); };
+    const auto skipTo = [&sql](int from, const QString &end) {
+        const int at = sql.indexOf(end, from);
+        return at < 0 ? sql.size() : at + end.size();
+    };
+    for (int i = 0; i < size;) {
+        const QChar c = sql.at(i);
+        if (c.isSpace()) {
+            ++i;
+            continue;
+        }
+        if (c == QLatin1Char(';') && depth == 0) {
+            if (inStatement)
+                statement(tokens);
+            tokens.clear();
+            inStatement = false;
+            ++i;
+            continue;
+        }
+        inStatement = true;
+        if (sql.midRef(i, 2) == QLatin1String("--")) {
+            inStatement = !tokens.isEmpty();
+            i = skipTo(i, QStringLiteral("\n"));
+        } else if (sql.midRef(i, 2) == QLatin1String("/*")) {
+            inStatement = !tokens.isEmpty();
+            i = skipTo(i + 2, QStringLiteral("*/"));
+        } else if (c == QLatin1Char('\'')) {
+            i = skipTo(i + 1, QStringLiteral("'"));
+        } else if (c == QLatin1Char('"')) {
+            QString text;
+            for (++i; i < size; ++i) {
+                if (sql.at(i) == QLatin1Char('"')) {
+                    if (i + 1 < size && sql.at(i + 1) == QLatin1Char('"'))
+                        ++i;
+                    else
+                        break;
+                }
+                text += sql.at(i);
+            }
+            ++i;
+            if (depth == 0)
+                tokens.append({ text, true });
+        } else if (c == QLatin1Char('$')) {
+            // dollar quoted string, $$...$$ or $tag$...$tag$
+            int end = i + 1;
+            while (end < size && sql.at(end) != QLatin1Char('$') && isNameChar(sql.at(end)))
+                ++end;
+            if (end < size && sql.at(end) == QLatin1Char('$'))
+                i = skipTo(end + 1, sql.mid(i, end + 1 - i));
+            else
+                i = end;
+        } else if (isNameChar(c)) {
+            const int start = i;
+            while (i < size && isNameChar(sql.at(i)))
+                ++i;
+            if (depth == 0)
+                tokens.append({ sql.mid(start, i - start), false });
+        } else {
+            if (depth == 0 && (c == QLatin1Char('(') || c == QLatin1Char('.')))
+                tokens.append({ QString(c), false });
+            if (c == QLatin1Char('('))
+                ++depth;
+            else if (c == QLatin1Char(')') && depth > 0)
+                --depth;
+            ++i;
+        }
+    }
+    if (inStatement)
+        statement(tokens);
+}
+
+// the transaction step of each of the count statements of sql and the table it writes to, or an empty string;
+// sql is scanned once for both, callers keep them for as long as the statements run
+static void qScanScript(const QString &sql, idx_t count, QVector<QDuckdbTransactionStep> *steps, QStringList *tables)
+{
+    steps->clear();
+    tables->clear();
+    qScanStatements(sql, [steps, tables](const QVector<QDuckdbSqlToken> &tokens) {
+        steps->append(qTransactionStep(tokens));
+        tables->append(qChangedTable(tokens));
+    });
+    // a scan that disagrees with DuckDB about the statements cannot be trusted
+    if (idx_t(steps->size()) != count) {
+        steps->clear();
+        tables->clear();
+    }
+}
+
+/*
+   Appends the column in the current row of a catalog query selecting
+   column_name, data_type, is_nullable, column_default and whether the column
+   is part of the primary key, starting at column 1.
+*/
+static void qAppendTableField(const QSqlQuery &q, const QString &tableName, QDuckdbTableInfo *info)
+{
+    const QString typeName = q.value(2).toString();
+    const duckdb_type type = qTypeFromName(typeName);
+    QString defVal = q.value(4).toString();
+    if (!defVal.isEmpty() && defVal.at(0) == QLatin1Char('\'')) {
+        const int end = defVal.lastIndexOf(QLatin1Char('\''));
+        if (end > 0)
+            defVal = defVal.mid(1, end - 1);
+    }
+
+    QSqlField fld(q.value(1).toString(), qFieldType(type, QSql::LowPrecisionDouble), tableName);
+    fld.setSqlType(type);
+    if (type == DUCKDB_TYPE_DECIMAL) {
+        // DECIMAL(width,scale)
+        const int open = typeName.indexOf(QLatin1Char('('));
+        const QStringList args = typeName.mid(open + 1, typeName.indexOf(QLatin1Char(')')) - open - 1)
+                .split(QLatin1Char(','));
+        if (open > 0 && args.size() == 2) {
+            fld.setLength(args.at(0).trimmed().toInt());
+            fld.setPrecision(args.at(1).trimmed().toInt());
+        }
+    }
+    // columns filled from a sequence are DuckDB's auto-increment
+    fld.setAutoValue(defVal.startsWith(QLatin1String("nextval(")));
+    fld.setRequired(!q.value(3).toBool());
+    fld.setDefaultValue(defVal);
+    info->record.append(fld);
+    if (q.value(5).toBool())
+        info->primaryIndex.append(fld);
+}
+
+/*
+   Columns and primary key of a table or view from the DuckDB catalog functions.
+   An unqualified name is looked up in the current schema, or in the temporary
+   database, a name with one qualifier in a schema of the current database
+   first and then in the main schema of an attached database.
+*/
+static QDuckdbTableInfo qLoadTableInfo(QSqlQuery &q, const QString &tableName, bool temporary)
+{
+    const QStringList parts = qSplitTableName(tableName);
+    QString filter;
+    if (parts.size() >= 3)
+        filter = QLatin1String("lower(c.database_name) = lower(?) AND lower(c.schema_name) = lower(?)");
+    else if (parts.size() == 2)
+        filter = QLatin1String("((c.database_name = current_database() AND lower(c.schema_name) = lower(?))"
+                               " OR (lower(c.database_name) = lower(?) AND c.schema_name = 'main'))");
+    else if (temporary)
+        filter = QLatin1String("c.database_name = 'temp'");
+    else
+        filter = QLatin1String("c.database_name = current_database() AND c.schema_name = current_schema()");
+    if (!temporary)
+        filter += QLatin1String(" AND c.database_name <> 'temp'");
+
+    q.prepare(QLatin1String("SELECT c.table_oid, c.column_name, c.data_type, c.is_nullable, c.column_default,"
+                            " coalesce(list_contains(k.constraint_column_names, c.column_name), false)"
+                            " FROM duckdb_columns() c LEFT JOIN duckdb_constraints() k"
+                            " ON k.table_oid = c.table_oid AND k.constraint_type = 'PRIMARY KEY'"
+                            " WHERE lower(c.table_name) = lower(?) AND ") + filter
+              + QLatin1String(" ORDER BY c.database_name = current_database() DESC, c.table_oid, c.column_index"));
+    q.addBindValue(parts.last());
+    if (parts.size() >= 3) {
+        q.addBindValue(parts.at(parts.size() - 3));
+        q.addBindValue(parts.at(parts.size() - 2));
+    } else if (parts.size() == 2) {
+        q.addBindValue(parts.first());
+        q.addBindValue(parts.first());
+    }
+
+    QDuckdbTableInfo info;
+    if (!q.exec())
+        return info;
+    qint64 table = -1;
+    while (q.next()) {
+        // only the first of several matching tables
+        if (table < 0)
+            table = q.value(0).toLongLong();
+        else if (q.value(0).toLongLong() != table)
+            break;
+        qAppendTableField(q, tableName, &info);
+    }
+    return info;
 }
 
-class QDuckdbResultPrivate;
+void QDuckdbDriverPrivate::refreshTemporaryTables()
+{
+    Q_Q(QDuckdbDriver);
+    const quint64 version = database->schemaVersion();
+    if (temporaryLoaded && temporaryVersion == version)
+        return;
+    temporaryLoaded = true;
+    temporaryVersion = version;
+    temporaryTables.clear();
+    temporaryViews.clear();
+    temporaryInfo.clear();
+
+    QSqlQuery query(q->createResult());
+    query.setForwardOnly(true);
+    if (query.exec(QLatin1String("SELECT table_name, false FROM duckdb_tables() WHERE database_name = 'temp'"
+                                 " UNION ALL SELECT view_name, true FROM duckdb_views() WHERE database_name = 'temp'"))) {
+        while (query.next())
+            (query.value(1).toBool() ? temporaryViews : temporaryTables).append(query.value(0).toString());
+    }
+}
 
-class QDuckdbResult : public QSqlCachedResult
+QDuckdbTableInfo QDuckdbDriverPrivate::tableInfo(const QString &table)
 {
-    Q_DECLARE_PRIVATE(QDuckdbResult)
-    friend class QDuckdbDriver;
+    Q_Q(QDuckdbDriver);
+    refreshTemporaryTables();
+    const QStringList parts = qSplitTableName(table);
+    const bool temporary = parts.size() == 1
+            ? temporaryTables.contains(parts.first(), Qt::CaseInsensitive)
+              || temporaryViews.contains(parts.first(), Qt::CaseInsensitive)
+            : parts.first().compare(QLatin1String("temp"), Qt::CaseInsensitive) == 0;
+
+    QDuckdbTableInfo info;
+    if (temporary) {
+        const auto it = temporaryInfo.constFind(table);
+        if (it != temporaryInfo.constEnd())
+            return it.value();
+    } else if (!schemaChanged && database->cachedTable(table, &info)) {
+        return info;
+    }
 
-public:
-    explicit QDuckdbResult(const QDuckdbDriver* db);
-    ~QDuckdbResult();
-    QVariant handle() const override;
-
-protected:
-    bool gotoNext(QSqlCachedResult::ValueCache& row, int idx) override;
-    bool reset(const QString &query) override;
-    bool prepare(const QString &query) override;
-    bool execBatch(bool arrayBind) override;
-    bool exec() override;
-    int size() override;
-    int numRowsAffected() override;
-    QVariant lastInsertId() const override;
-    QSqlRecord record() const override;
-    void detachFromResultSet() override;
-    void virtual_hook(int id, void *data) override;
-};
+    const quint64 version = database->schemaVersion();
+    QSqlQuery query(q->createResult());
+    query.setForwardOnly(true);
+    info = qLoadTableInfo(query, table, temporary);
+    if (temporary)
+        temporaryInfo.insert(table, info);
+    else if (!schemaChanged)
+        database->cacheTable(table, version, info);
+    return info;
+}
 
-class QDuckdbDriverPrivate : public QSqlDriverPrivate
+QStringList QDuckdbDriverPrivate::tableNames(QSql::TableType type)
 {
-    Q_DECLARE_PUBLIC(QDuckdbDriver)
+    Q_Q(QDuckdbDriver);
+    QStringList names;
+    if (!schemaChanged && database->cachedTables(type, &names))
+        return names;
+
+    QLatin1String sql("");
+    switch (type) {
+    case QSql::Tables:
+        sql = QLatin1String("SELECT CASE WHEN schema_name = current_schema() THEN table_name"
+                            " ELSE schema_name || '.' || table_name END FROM duckdb_tables()"
+                            " WHERE database_name = current_database() AND NOT internal ORDER BY schema_name, table_name");
+        break;
+    case QSql::Views:
+        sql = QLatin1String("SELECT CASE WHEN schema_name = current_schema() THEN view_name"
+                            " ELSE schema_name || '.' || view_name END FROM duckdb_views()"
+                            " WHERE database_name = current_database() AND NOT internal ORDER BY schema_name, view_name");
+        break;
+    case QSql::SystemTables:
+        sql = QLatin1String("SELECT CASE WHEN schema_name = 'main' THEN view_name"
+                            " ELSE schema_name || '.' || view_name END FROM duckdb_views()"
+                            " WHERE internal ORDER BY schema_name, view_name");
+        break;
+    default:
+        return names;
+    }
 
-public:
-    inline QDuckdbDriverPrivate() : QSqlDriverPrivate(QSqlDriver::SQLite) {
-        access=new duckdb_database;
-        conn=new duckdb_connection;
+    const quint64 version = database->schemaVersion();
+    QSqlQuery query(q->createResult());
+    query.setForwardOnly(true);
+    if (query.exec(sql)) {
+        while (query.next())
+            names.append(query.value(0).toString());
     }
-    duckdb_database *access=nullptr;
-    duckdb_connection  *conn=nullptr;
-    duckdb_prepared_statement stmt;
-    QVector<QDuckdbResult *> results;
-    QStringList notificationid;
-};
+    if (!schemaChanged)
+        database->cacheTables(type, version, names);
+    return names;
+}
 
 
 class QDuckdbResultPrivate : public QSqlCachedResultPrivate
@@ -174,16 +2529,66 @@ public:
     Q_DECLARE_SQLDRIVER_PRIVATE(QDuckdbDriver)
     using QSqlCachedResultPrivate::QSqlCachedResultPrivate;
     void cleanup();
-    bool fetchNext(QSqlCachedResult::ValueCache &values, int idx, bool initialFetch);
+    bool fetchNext(QSqlCachedResult::ValueCache &values, int idx);
+    // moves to the next non empty chunk of the result and decodes it into chunkValues
+    bool fetchChunk();
+    void releaseChunk();
+    // the vector of column in the current chunk if the query is on the last fetched row, else nullptr
+    duckdb_vector currentVector(int column) const;
     // initializes the recordInfo and the cache
     void initColumns();
+    void resetCursor();
     void finalize();
+    // prepares statement index of the extracted query in place of the current one
+    bool prepareStatement(idx_t index);
+    // the columns of the prepared statement before it is executed
+    QSqlRecord preparedRecord();
 
     duckdb_prepared_statement  *stmt=nullptr;
+    // classified once by prepare()
+    duckdb_statement_type statementType = DUCKDB_STATEMENT_TYPE_INVALID;
+    // the statements of the query, all run by exec(), each one is a result set reached with nextResult()
+    duckdb_extracted_statements extracted = nullptr;
+    // the connection stmt was prepared on, statements follow the driver into and out of commit groups
+    duckdb_connection preparedConnection = nullptr;
+    idx_t statementCount = 0;
+    idx_t statementIndex = 0;
+    // bound values taken by the statements before the current one
+    int valueOffset = 0;
+    // the tables the statements write to, found on the first change while notifications are on
+    void recordChange();
+    QString query;
+    // the query is scanned once, on the first transaction statement or change, and kept until it is prepared again
+    void scanStatements();
+    QDuckdbTransactionStep transactionStep();
+    QVector<QDuckdbTransactionStep> transactionSteps;
+    QStringList changedTables;
+    bool statementsScanned = false;
+    // the result set of statement resultIndex, one of results
     duckdb_result *result=nullptr;
+    QVector<duckdb_result *> results;
+    int resultIndex = 0;
+    void clearResults();
     QSqlRecord rInf;
-    QVector<QVariant> firstRow;
-    idx_t row_count=0;
+    QSqlRecord preparedInfo;
+    bool preparedInfoValid = false;
+    QVector<QDuckdbColumnType> columns;
+    // the rows of the current chunk, row-major, moved into the cache one row at a time
+    QVector<QVariant> chunkValues;
+    // chunks referenced by zero-copy BLOB values, released with the result set
+    QVector<duckdb_data_chunk> pinnedChunks;
+    bool pinChunks = false;
+    // forward only results decode the cells of the current row on demand instead of per chunk
+    bool lazyValues = false;
+    // the chunk holding the last fetched row, owned by pinnedChunks when pinChunks is set
+    duckdb_data_chunk chunk = nullptr;
+    QVector<duckdb_vector> chunkVectors;
+    // conversion buffers of stringAt(), one per column
+    mutable QVector<QString> stringCells;
+    idx_t chunkIndex = 0;
+    idx_t chunkRow = 0;
+    idx_t chunkSize = 0;
+    qint64 fetchedRows = 0;
 };
 
 void QDuckdbResultPrivate::cleanup()
@@ -196,14 +2601,177 @@ void QDuckdbResultPrivate::cleanup()
     q->cleanup();
 }
 
+void QDuckdbResultPrivate::releaseChunk()
+{
+    if (chunk && !pinChunks)
+        duckdb_destroy_data_chunk(&chunk);
+    chunk = nullptr;
+    chunkVectors.clear();
+}
+
+duckdb_vector QDuckdbResultPrivate::currentVector(int column) const
+{
+    Q_Q(const QDuckdbResult);
+    if (!chunk || chunkRow == 0 || column < 0 || column >= chunkVectors.size() || q->at() != fetchedRows - 1)
+        return nullptr;
+    return chunkVectors.at(column);
+}
+
+void QDuckdbResultPrivate::resetCursor()
+{
+    releaseChunk();
+    chunkValues.clear();
+    stringCells.clear();
+    for (duckdb_data_chunk &chunk : pinnedChunks)
+        duckdb_destroy_data_chunk(&chunk);
+    pinnedChunks.clear();
+    chunkIndex = 0;
+    chunkRow = 0;
+    chunkSize = 0;
+    fetchedRows = 0;
+}
+
 void QDuckdbResultPrivate::finalize()
 {
-    if(result!=nullptr)
-        duckdb_destroy_result(result);
-    if (stmt!=nullptr)
+    resetCursor();
+    columns.clear();
+    pinChunks = false;
+    preparedInfo.clear();
+    preparedInfoValid = false;
+    statementType = DUCKDB_STATEMENT_TYPE_INVALID;
+    clearResults();
+    if (stmt != nullptr) {
         duckdb_destroy_prepare(stmt);
+        delete stmt;
+    }
     stmt = nullptr;
+    preparedConnection = nullptr;
+    if (extracted != nullptr)
+        duckdb_destroy_extracted(&extracted);
+    extracted = nullptr;
+    statementCount = 0;
+    statementIndex = 0;
+    valueOffset = 0;
+    transactionSteps.clear();
+    changedTables.clear();
+    statementsScanned = false;
+}
+
+void QDuckdbResultPrivate::clearResults()
+{
+    for (duckdb_result *res : qAsConst(results)) {
+        duckdb_destroy_result(res);
+        delete res;
+    }
+    results.clear();
     result = nullptr;
+    resultIndex = 0;
+}
+
+void QDuckdbResultPrivate::scanStatements()
+{
+    if (statementsScanned)
+        return;
+    qScanScript(query, statementCount, &transactionSteps, &changedTables);
+    statementsScanned = true;
+}
+
+QDuckdbTransactionStep QDuckdbResultPrivate::transactionStep()
+{
+    scanStatements();
+    return statementIndex < idx_t(transactionSteps.size()) ? transactionSteps.at(int(statementIndex))
+                                                           : QDuckdbNoTransactionStep;
+}
+
+void QDuckdbResultPrivate::recordChange()
+{
+    switch (statementType) {
+    case DUCKDB_STATEMENT_TYPE_INSERT:
+    case DUCKDB_STATEMENT_TYPE_UPDATE:
+    case DUCKDB_STATEMENT_TYPE_DELETE:
+    case DUCKDB_STATEMENT_TYPE_COPY:
+        break;
+    default:
+        return;
+    }
+    scanStatements();
+    if (statementIndex >= idx_t(changedTables.size()))
+        return;
+    // RETURNING makes a query of the statement, the rows it returns are the rows it changed
+    const qint64 rows = duckdb_result_return_type(*result) == DUCKDB_RESULT_TYPE_QUERY_RESULT
+            ? qint64(duckdb_row_count(result)) : qint64(duckdb_rows_changed(result));
+    const_cast<QDuckdbDriverPrivate *>(drv_d_func())->recordChange(changedTables.at(int(statementIndex)), rows);
+}
+
+/*
+   Statements are prepared one at a time as the query reaches them, so a
+   statement may refer to tables created by the ones before it.
+*/
+bool QDuckdbResultPrivate::prepareStatement(idx_t index)
+{
+    Q_Q(QDuckdbResult);
+    if (stmt)
+        duckdb_destroy_prepare(stmt);
+    else
+        stmt = new duckdb_prepared_statement;
+    statementIndex = index;
+    preparedInfo.clear();
+    preparedInfoValid = false;
+    preparedConnection = *drv_d_func()->conn;
+    const int res = duckdb_prepare_extracted_statement(preparedConnection, extracted, index, stmt);
+    if (res != DuckDBSuccess) {
+        const char *error_message = duckdb_prepare_error(*stmt);
+        q->setLastError(qMakeError(QCoreApplication::translate("QDuckdbResult","Unable to execute statement"), error_message,QSqlError::StatementError, res));
+        finalize();
+        const_cast<QDuckdbDriverPrivate *>(drv_d_func())->statementFailed();
+        return false;
+    }
+    statementType = duckdb_prepared_statement_type(*stmt);
+    return true;
+}
+
+/*
+   The column names and types a query will return are known once it is bound,
+   but the C API of DuckDB 1.1.3 only describes the parameters of a prepared
+   statement. A single query is described by running it as a LIMIT 0 subquery
+   with every parameter bound to NULL, which leaves the column types intact.
+   Other statements report a change count, and scripts are described once
+   executed.
+*/
+QSqlRecord QDuckdbResultPrivate::preparedRecord()
+{
+    Q_Q(QDuckdbResult);
+    if (!preparedInfoValid && stmt) {
+        preparedInfoValid = true;
+        // a grouped transaction shares its connection, the query is described once executed
+        if (statementType == DUCKDB_STATEMENT_TYPE_SELECT && statementCount == 1 && !drv_d_func()->commitGroup) {
+            QString text = query.trimmed();
+            while (text.endsWith(QLatin1Char(';')))
+                text = text.left(text.size() - 1).trimmed();
+            // the newline ends a trailing line comment
+            const QByteArray describe = "SELECT * FROM (" + text.toUtf8() + "\n) LIMIT 0";
+            duckdb_prepared_statement described;
+            duckdb_result res;
+            if (duckdb_prepare(*drv_d_func()->conn, describe.constData(), &described) == DuckDBSuccess) {
+                for (idx_t i = 1; i <= duckdb_nparams(described); ++i)
+                    duckdb_bind_null(described, i);
+                const_cast<QDuckdbDriverPrivate *>(drv_d_func())->rewindArrowIpcViews();
+                if (duckdb_execute_prepared(described, &res) == DuckDBSuccess) {
+                    const QString tableName = QStringLiteral("query");
+                    for (idx_t i = 0; i < duckdb_column_count(&res); ++i) {
+                        const QString colName = QString::fromUtf8(duckdb_column_name(&res, i)).remove(QLatin1Char('"'));
+                        const duckdb_type type = duckdb_column_type(&res, i);
+                        QSqlField fld(colName, qFieldType(type, QSql::LowPrecisionDouble), tableName);
+                        fld.setSqlType(type);
+                        preparedInfo.append(fld);
+                    }
+                }
+                duckdb_destroy_result(&res);
+            }
+            duckdb_destroy_prepare(&described);
+        }
+    }
+    return qApplyPrecisionPolicy(preparedInfo, q->numericalPrecisionPolicy());
 }
 
 void QDuckdbResultPrivate::initColumns()
@@ -214,134 +2782,117 @@ void QDuckdbResultPrivate::initColumns()
         return;
 
     q->init(nCols);
+    columns.clear();
+    columns.reserve(nCols);
 
     for (int i = 0; i < nCols; ++i) {
         QString colName = QString::fromUtf8(duckdb_column_name(result, i)).remove(QLatin1Char('"'));
         const QString tableName=QStringLiteral("query");
         int stp =  duckdb_column_type(result, i);
 
-        QVariant::Type fieldType;
+        duckdb_logical_type logicalType = duckdb_column_logical_type(result, i);
+        columns.append(qColumnType(logicalType, q->numericalPrecisionPolicy()));
+        duckdb_destroy_logical_type(&logicalType);
 
-        // Get the proper type for the field based on stp value
-        switch (stp) {
-        case DUCKDB_TYPE_INTEGER:
-            fieldType = QVariant::Int;
-            break;
-        case DUCKDB_TYPE_FLOAT:
-            fieldType = QVariant::Double;
-            break;
-        case DUCKDB_TYPE_BLOB:
-            fieldType = QVariant::ByteArray;
-            break;
-        case DUCKDB_TYPE_VARCHAR:
-            fieldType = QVariant::String;
-            break;
-        case DUCKDB_TYPE_SQLNULL:
-            fieldType = QVariant::Invalid;
-            break;
-        default:
-            fieldType = QVariant::Invalid;
-            qCritical() <<  "unsupported type" << stp << colName;
-            break;
-        }
+        const QVariant::Type fieldType = columns.constLast().variantType;
+        if (fieldType == QVariant::Invalid && stp != DUCKDB_TYPE_SQLNULL && stp != DUCKDB_TYPE_UNION)
+            qCritical() << "unsupported type" << stp << colName;
 
         QSqlField fld(colName, fieldType, tableName);
         fld.setSqlType(stp);
         rInf.append(fld);
     }
+
+    if (drv_d_func()->internStrings) {
+        for (QDuckdbColumnType &column : columns)
+            qSetStringTables(column);
+    }
+
+    lazyValues = q->isForwardOnly();
+    stringCells.resize(nCols);
+
+    pinChunks = drv_d_func()->zeroCopyBlobs && std::any_of(columns.cbegin(), columns.cend(), qHasBlob);
+    if (pinChunks) {
+        for (QDuckdbColumnType &column : columns)
+            qSetRawData(column, true);
+    }
+
+    if (std::any_of(columns.cbegin(), columns.cend(), qHasTimeZone)) {
+        const QTimeZone timeZone = const_cast<QDuckdbDriverPrivate *>(drv_d_func())->sessionTimeZone();
+        for (QDuckdbColumnType &column : columns)
+            qSetTimeZone(column, timeZone);
+    }
 }
 
-bool QDuckdbResultPrivate::fetchNext(QSqlCachedResult::ValueCache &values, int idx, bool initialFetch)
+/*
+   The result is materialized, so chunks are fetched by index and every column
+   of a chunk is decoded in one pass over its vector. The chunk stays alive
+   until the next one is fetched, for the typed accessors and lazy decoding;
+   past the last chunk it is kept, the query may still be on its last row.
+*/
+bool QDuckdbResultPrivate::fetchChunk()
 {
     Q_Q(QDuckdbResult);
-    int row_count = duckdb_row_count(result);
-    qCritical() << values.size()<<row_count << idx;
-    if(row_count < idx) return false;
-    int i;
+    const int nCols = columns.size();
+    const idx_t chunkCount = duckdb_result_chunk_count(*result);
+    while (chunkIndex < chunkCount) {
+        duckdb_data_chunk next = duckdb_result_get_chunk(*result, chunkIndex++);
+        if (!next) {
+            q->setLastError(QSqlError(QCoreApplication::translate("QDuckdbResult", "Unable to fetch row"),
+                                      QString(), QSqlError::ConnectionError));
+            return false;
+        }
+        const idx_t size = duckdb_data_chunk_get_size(next);
+        if (size == 0) {
+            duckdb_destroy_data_chunk(&next);
+            continue;
+        }
+
+        releaseChunk();
+        chunk = next;
+        chunkRow = 0;
+        chunkSize = size;
+        if (pinChunks)
+            pinnedChunks.append(chunk);
+        chunkVectors.resize(nCols);
+        for (int i = 0; i < nCols; ++i)
+            chunkVectors[i] = duckdb_data_chunk_get_vector(chunk, i);
+
+        if (!lazyValues) {
+            chunkValues.resize(int(chunkSize) * nCols);
+            for (int i = 0; i < nCols; ++i)
+                qDecodeColumn(columns.at(i), chunkVectors.at(i), chunkSize, chunkValues.data() + i, nCols);
+        }
+        return true;
+    }
+    return false;
+}
 
+bool QDuckdbResultPrivate::fetchNext(QSqlCachedResult::ValueCache &values, int idx)
+{
+    Q_Q(QDuckdbResult);
 
-    if (!stmt) {
+    if (!stmt || !result) {
         q->setLastError(QSqlError(QCoreApplication::translate("QDuckdbResult", "Unable to fetch row"),
                                   QCoreApplication::translate("QDuckdbResult", "No query"), QSqlError::ConnectionError));
         q->setAt(QSql::AfterLastRow);
         return false;
     }
-    // if(!result){
-    //     result=new duckdb_result;
-    // }
-
-
-    // if(initialFetch) {
-    //     res = duckdb_execute_prepared(*stmt, result);
-    //     if(res==DuckDBError){
-    //         const char *error_message = duckdb_result_error(result);
-    //         q->setLastError(qMakeError(QCoreApplication::translate("QDuckdbResult","Unable to execute statement"), error_message,QSqlError::StatementError, res));
-    //         q->setAt(QSql::AfterLastRow);
-    //         return false;
-    //     }
-    //     firstRow.clear();
-    //     idx_t column_count = duckdb_column_count(result);
-    //     row_count = duckdb_row_count(result);
-    //     firstRow.resize(column_count);
-    //     if (rInf.isEmpty())
-    //         initColumns(false);// must be first call.
-    //     for(idx_t i=0;i<row_count;i++)
-    //         values[i]=firstRow[i];
-    // }
-
 
-    if (idx < 0 && !initialFetch)
-        return true;
-    for (i = 0; i < rInf.count(); ++i)
-    {
-        // qCritical() << "column_count" << i << idx;
-        auto column_type = duckdb_column_type(result, i);
-        switch (column_type) {
-        case DUCKDB_TYPE_BLOB:
-            //     // values[i + idx] = QByteArray(static_cast<const char *>(
-            //     //             sqlite3_column_blob(stmt, i)),
-            //     //             sqlite3_column_bytes(stmt, i));
-            values[i + idx]=QByteArray{};//TODO
-            break;
-        case DUCKDB_TYPE_INTEGER:
-            values[i+idx] = duckdb_value_int64(result, i,idx);
-            break;
-        // case DUCKDB_TYPE_FLOAT:
-        //     switch(q->numericalPrecisionPolicy()) {
-        //         case QSql::LowPrecisionInt32:
-        //             values[i + idx] = sqlite3_column_int(stmt, i);
-        //             break;
-        //         case QSql::LowPrecisionInt64:
-        //             values[i + idx] = sqlite3_column_int64(result, i);
-        //             break;
-        //         case QSql::LowPrecisionDouble:
-        //         case QSql::HighPrecision:
-        //         default:
-        //             values[i + idx] = sqlite3_column_double(result, i);
-        //             break;
-        //     };
-        //     break;
-        case DUCKDB_TYPE_SQLNULL:
-            values[i + idx] = QVariant(QVariant::String);
-            break;
-        case DUCKDB_TYPE_VARCHAR:
-        {
-            char *val = duckdb_value_varchar(result, i,idx);
-            if(val!=nullptr)
-            {
-                values[i + idx] = QString::fromUtf8(val);
-                duckdb_free(val);
-            }else{
-                values[i + idx] = QVariant(QVariant::String);
-            }
-        }
-        break;
-        default:
-            qCritical() << "unsupported type " << column_type << duckdb_column_name(result,idx);
-            break;
-        }
+    if (chunkRow >= chunkSize && !fetchChunk()) {
+        q->setAt(QSql::AfterLastRow);
+        return false;
     }
 
+    // a negative index skips the row, lazy results decode in QDuckdbResult::data()
+    if (idx >= 0 && !lazyValues) {
+        const int nCols = columns.size();
+        QVariant *row = chunkValues.data() + int(chunkRow) * nCols;
+        for (int i = 0; i < nCols; ++i)
+            values[idx + i] = std::move(row[i]);
+    }
+    ++chunkRow;
+    ++fetchedRows;
     return true;
 }
 
@@ -381,18 +2932,17 @@ bool QDuckdbResult::prepare(const QString &query)
     d->cleanup();
 
     setSelect(false);
-    if(!d->stmt){
-        d->stmt=new duckdb_prepared_statement ;
-    }
-    int res = duckdb_prepare(*d->drv_d_func()->conn, query.toUtf8().constData(), d->stmt);
-    if (res != DuckDBSuccess) {
-        const char *error_message = duckdb_prepare_error(*d->stmt);
-        setLastError(qMakeError(QCoreApplication::translate("QDuckdbResult","Unable to execute statement"), error_message,QSqlError::StatementError, res));
+    d->query = query;
+    QMutexLocker lock(const_cast<QDuckdbDriverPrivate *>(d->drv_d_func())->connectionMutex());
+    // the query is parsed once, a script yields one prepared statement per result set
+    d->statementCount = duckdb_extract_statements(*d->drv_d_func()->conn, query.toUtf8().constData(), &d->extracted);
+    if (d->statementCount == 0) {
+        const char *error_message = duckdb_extract_statements_error(d->extracted);
+        setLastError(qMakeError(QCoreApplication::translate("QDuckdbResult","Unable to execute statement"), error_message,QSqlError::StatementError, DuckDBError));
         d->finalize();
         return false;
     }
-    // setSelect(true);
-    return true;
+    return d->prepareStatement(0);
 }
 
 bool QDuckdbResult::execBatch(bool arrayBind)
@@ -418,16 +2968,88 @@ bool QDuckdbResult::execBatch(bool arrayBind)
     return true;
 }
 
+/*
+   Every statement of a script runs here, in order, so that none is skipped
+   when the caller does not step through the result sets. The results are
+   kept until the next exec() and nextResult() only moves to the next one.
+   A failing statement stops the script and fails exec(), the statements
+   before it stay executed.
+*/
 bool QDuckdbResult::exec()
 {
     Q_D(QDuckdbResult);
-    QVector<QVariant> values = boundValues();
-
+    QDuckdbDriverPrivate *driverPrivate = const_cast<QDuckdbDriverPrivate *>(d->drv_d_func());
+    // the members of a grouped transaction run their statements one at a time
+    QMutexLocker lock(driverPrivate->connectionMutex());
+    if (!driverPrivate->commitMemberActive()) {
+        setLastError(qMakeError(QCoreApplication::translate("QDuckdbResult", "Unable to execute statement"),
+                                qGroupedTransactionDropped, QSqlError::TransactionError, DuckDBError));
+        return false;
+    }
+    // running a script again starts over at its first statement
+    if (d->statementIndex > 0 && !d->prepareStatement(0))
+        return false;
+    d->valueOffset = 0;
     d->rInf.clear();
     clearValues();
     setLastError(QSqlError());
     setActive(false);
     setAt(QSql::BeforeFirstRow);
+    d->resetCursor();
+    d->clearResults();
+    for (;;) {
+        if (!execStatement())
+            return false;
+        if (d->statementIndex + 1 >= d->statementCount)
+            break;
+        d->valueOffset += int(duckdb_nparams(*d->stmt));
+        if (!d->prepareStatement(d->statementIndex + 1))
+            return false;
+    }
+    return showResult(0);
+}
+
+bool QDuckdbResult::nextResult()
+{
+    Q_D(QDuckdbResult);
+    if (d->resultIndex + 1 >= d->results.size())
+        return false;
+    return showResult(d->resultIndex + 1);
+}
+
+bool QDuckdbResult::showResult(int index)
+{
+    Q_D(QDuckdbResult);
+    d->rInf.clear();
+    clearValues();
+    setActive(false);
+    setAt(QSql::BeforeFirstRow);
+    d->resetCursor();
+    d->resultIndex = index;
+    d->result = d->results.at(index);
+    // DML without RETURNING and DDL only report a change count, there is no record or cache to set up
+    if (duckdb_result_return_type(*d->result) != DUCKDB_RESULT_TYPE_QUERY_RESULT) {
+        setSelect(false);
+        setActive(true);
+        return true;
+    }
+    d->initColumns();
+    setSelect(true);
+    setActive(true);
+    return true;
+}
+
+bool QDuckdbResult::execStatement()
+{
+    Q_D(QDuckdbResult);
+    QDuckdbDriverPrivate *driverPrivate = const_cast<QDuckdbDriverPrivate *>(d->drv_d_func());
+    // prepared before a grouped transaction began, or inside one that has ended
+    if (d->stmt && d->preparedConnection != *driverPrivate->conn && !d->prepareStatement(d->statementIndex))
+        return false;
+    QVector<QVariant> values = boundValues();
+    // the statements of a script take the bound values in order
+    if (d->statementCount > 1)
+        values = values.mid(d->valueOffset, int(duckdb_nparams(*d->stmt)));
 
     int res=0;
     // if(d->stmt) {
@@ -492,58 +3114,7 @@ bool QDuckdbResult::exec()
 
     if (paramCountIsValid) {
         for (int i = 0; i < paramCount; ++i) {
-            res = DuckDBSuccess;
-            const QVariant &value = values.at(i);
-
-            if (value.isNull()) {
-                res = duckdb_bind_null(*d->stmt, i + 1);
-            } else {
-                switch (value.userType()) {
-                case QVariant::ByteArray: {
-                    res = DuckDBError;
-                    // const QByteArray *ba = static_cast<const QByteArray*>(value.constData());
-                    // res = duckdb_bind_blob(d->stmt, i + 1, ba->constData(),
-                    //                         ba->size(), SQLITE_STATIC);
-                    break; }
-                case QVariant::Int:
-                case QVariant::Bool:
-                    res = duckdb_bind_int32(*d->stmt, i + 1, value.toInt());
-                    break;
-                case QVariant::Double:
-                    res = duckdb_bind_double(*d->stmt, i + 1, value.toDouble());
-                    break;
-                case QVariant::UInt:
-                case QVariant::LongLong:
-                    res = duckdb_bind_int64(*d->stmt, i + 1, value.toLongLong());
-                    break;
-                case QVariant::DateTime: {
-                    res = DuckDBError;
-                    const QDateTime dateTime = value.toDateTime();
-                    const QString str = dateTime.toString(Qt::ISODateWithMs);
-                    // res = duckdb_bind_text16(d->stmt, i + 1, str.utf16(),
-                    //                           str.size() * sizeof(ushort), SQLITE_TRANSIENT);
-                    break;
-                }
-                case QVariant::Time: {
-                    res = DuckDBError;
-                    const QTime time = value.toTime();
-                    const QString str = time.toString(u"hh:mm:ss.zzz");
-                    // res = duckdb_bind_text16(d->stmt, i + 1, str.utf16(),
-                    //                           str.size() * sizeof(ushort), SQLITE_TRANSIENT);
-                    break;
-                }
-                case QVariant::String: {
-                    // lifetime of string == lifetime of its qvariant
-                    const QString *str = static_cast<const QString*>(value.constData());
-                    res = duckdb_bind_varchar(*d->stmt, i + 1, str->toUtf8().constData());
-                    break; }
-                default: {
-                    QString str = value.toString();
-                    // SQLITE_TRANSIENT makes sure that sqlite buffers the data
-                    res = duckdb_bind_varchar(*d->stmt, i + 1, str.toUtf8().constData());
-                    break; }
-                }
-            }
+            res = qBindValue(*d->stmt, i + 1, values.at(i));
             if (res != DuckDBSuccess) {
                 setLastError(qMakeError(QCoreApplication::translate("QDuckdbResult",
                                                                     "Unable to bind parameters"),"", QSqlError::StatementError, res));
@@ -563,70 +3134,408 @@ bool QDuckdbResult::exec()
         return false;
     }
     // setSelect(!d->rInf.isEmpty());
-    if(d->result==nullptr){
-        d->result=new duckdb_result;
-    }
+    d->result = new duckdb_result;
+    d->results.append(d->result);
+    d->resultIndex = d->results.size() - 1;
+    driverPrivate->rewindArrowIpcViews();
     res = duckdb_execute_prepared(*d->stmt, d->result);
     if(res==DuckDBError){
         const char *error_message = duckdb_result_error(d->result);
         setLastError(qMakeError(QCoreApplication::translate("QDuckdbResult","Unable to execute statement"), error_message,QSqlError::StatementError, res));
+        driverPrivate->lastErrorType = duckdb_result_error_type(d->result);
+        driverPrivate->statementFailed();
         setAt(QSql::AfterLastRow);
         return false;
     }
-    d->initColumns();
-    setSelect(true);
-    setActive(true);
-
+    if (d->statementType != DUCKDB_STATEMENT_TYPE_SELECT)
+        driverPrivate->logGroupStatement(d->query.toUtf8(), d->statementIndex, values);
+    driverPrivate->statementExecuted(d->statementType, d->statementType == DUCKDB_STATEMENT_TYPE_TRANSACTION
+                                     ? d->transactionStep()
+                                     : QDuckdbNoTransactionStep);
+    if (driverPrivate->database && driverPrivate->database->hasListeners())
+        d->recordChange();
     return true;
 }
 
 bool QDuckdbResult::gotoNext(QSqlCachedResult::ValueCache& row, int idx)
 {
     Q_D(QDuckdbResult);
-    return d->fetchNext(row, idx, false);
+    return d->fetchNext(row, idx);
+}
+
+int QDuckdbResult::size()
+{
+    return -1;
+}
+
+int QDuckdbResult::numRowsAffected()
+{
+    Q_D(const QDuckdbResult);
+    if (!d->result || isSelect())
+        return -1;
+    return int(duckdb_rows_changed(d->result));
+}
+
+QVariant QDuckdbResult::lastInsertId() const
+{
+    Q_D(const QDuckdbResult);
+    // if (isActive()) {
+    //     qint64 id = sqlite3_last_insert_rowid(d->drv_d_func()->access);
+    //     if (id)
+    //         return id;
+    // }
+    return QVariant();
+}
+
+QSqlRecord QDuckdbResult::record() const
+{
+    Q_D(const QDuckdbResult);
+    // a prepared query describes its columns before exec()
+    if (!isActive() && d->stmt)
+        return const_cast<QDuckdbResultPrivate *>(d)->preparedRecord();
+    if (!isActive() || !isSelect())
+        return QSqlRecord();
+    return d->rInf;
+}
+
+void QDuckdbResult::detachFromResultSet()
+{
+    Q_D(QDuckdbResult);
+    if (d->stmt)
+        duckdb_clear_bindings(*d->stmt);//sqlite3_reset(d->stmt);
+}
+
+bool QDuckdbResult::exportArrowSchema(ArrowSchema *schema) const
+{
+    Q_D(const QDuckdbResult);
+    duckdb_result *res = resultHandle();
+    if (!res)
+        return false;
+    QDuckdbDriverPrivate *drv = const_cast<QDuckdbDriverPrivate *>(d->drv_d_func());
+    drv->sessionTimeZone();
+    return qArrowSchemaFromResult(res, drv->timeZoneId, schema);
+}
+
+bool QDuckdbResult::exportArrowStream(ArrowArrayStream *stream) const
+{
+    Q_D(const QDuckdbResult);
+    duckdb_result *res = resultHandle();
+    if (!res)
+        return false;
+    QDuckdbDriverPrivate *drv = const_cast<QDuckdbDriverPrivate *>(d->drv_d_func());
+    drv->sessionTimeZone();
+    stream->get_schema = qArrowStreamGetSchema;
+    stream->get_next = qArrowStreamGetNext;
+    stream->get_last_error = qArrowStreamGetLastError;
+    stream->release = qArrowStreamRelease;
+    stream->private_data = new QDuckdbArrowStream{ res, drv->timeZoneId, 0, QByteArray() };
+    return true;
+}
+
+bool QDuckdbResult::exportArrowIpc(QIODevice *device, ArrowIpcFormat format) const
+{
+    ArrowArrayStream stream;
+    if (!exportArrowStream(&stream))
+        return false;
+
+    QDuckdbArrowIpcWriter writer(device, format == ArrowIpcFile);
+    ArrowSchema schema;
+    bool ok = stream.get_schema(&stream, &schema) == 0;
+    if (ok) {
+        ok = writer.writeSchema(&schema);
+        if (schema.release)
+            schema.release(&schema);
+    }
+    while (ok) {
+        ArrowArray array;
+        ok = stream.get_next(&stream, &array) == 0;
+        if (!ok || !array.release)
+            break;
+        ok = writer.writeBatch(&array);
+        array.release(&array);
+    }
+    if (ok)
+        ok = writer.finish();
+    else if (writer.errorString().isEmpty())
+        qWarning("QDuckdbResult::exportArrowIpc: %s", stream.get_last_error(&stream));
+    else
+        qWarning() << "QDuckdbResult::exportArrowIpc:" << writer.errorString();
+    stream.release(&stream);
+    return ok;
+}
+
+bool QDuckdbResult::writeBlob(int column, QIODevice *device)
+{
+    Q_D(QDuckdbResult);
+    if (!isActive() || !isValid() || column < 0 || column >= record().count())
+        return false;
+
+    // the current row is written straight from its chunk, a cached row shares its QByteArray
+    QByteArray cached;
+    const char *ptr = nullptr;
+    qint64 remaining = 0;
+    const duckdb_vector vector = d->currentVector(column);
+    const duckdb_type type = d->columns.at(column).type;
+    if (vector && (type == DUCKDB_TYPE_BLOB || type == DUCKDB_TYPE_VARCHAR)) {
+        if (isNullAt(column))
+            return true;
+        const duckdb_string_t &str = static_cast<const duckdb_string_t *>(duckdb_vector_get_data(vector))[d->chunkRow - 1];
+        ptr = QDuckdb::stringData(str);
+        remaining = str.value.inlined.length;
+    } else {
+        cached = data(column).toByteArray();
+        ptr = cached.constData();
+        remaining = cached.size();
+    }
+
+    while (remaining > 0) {
+        const qint64 written = device->write(ptr, qMin(remaining, qBlobBufferSize));
+        if (written < 0) {
+            qWarning() << "QDuckdbResult::writeBlob:" << device->errorString();
+            return false;
+        }
+        ptr += written;
+        remaining -= written;
+        // keep the buffer of sockets and processes bounded, a device that stops draining fails
+        if (device->isSequential() && device->bytesToWrite() > qBlobBufferSize
+                && !device->waitForBytesWritten(qBlobDeviceTimeout)) {
+            qWarning() << "QDuckdbResult::writeBlob:" << device->errorString();
+            return false;
+        }
+    }
+    return true;
+}
+
+QVariant QDuckdbResult::data(int i)
+{
+    Q_D(QDuckdbResult);
+    if (d->lazyValues) {
+        if (const duckdb_vector vector = d->currentVector(i))
+            return qDecodeValue(d->columns.at(i), vector, d->chunkRow - 1);
+    }
+    return QSqlCachedResult::data(i);
+}
+
+bool QDuckdbResult::isNull(int i)
+{
+    return isNullAt(i);
+}
+
+/*
+   The typed accessors are const so that they can be called on the result of
+   a QSqlQuery; rows the cursor has already cached are read through the cache.
+*/
+bool QDuckdbResult::isNullAt(int column) const
+{
+    Q_D(const QDuckdbResult);
+    if (const duckdb_vector vector = d->currentVector(column)) {
+        uint64_t *validity = duckdb_vector_get_validity(vector);
+        return validity && !duckdb_validity_row_is_valid(validity, d->chunkRow - 1);
+    }
+    return const_cast<QDuckdbResult *>(this)->QSqlCachedResult::isNull(column);
 }
 
-int QDuckdbResult::size()
+qint64 QDuckdbResult::int64At(int column) const
 {
-    return -1;
+    Q_D(const QDuckdbResult);
+    const duckdb_vector vector = d->currentVector(column);
+    if (!vector)
+        return const_cast<QDuckdbResult *>(this)->data(column).toLongLong();
+    if (isNullAt(column))
+        return 0;
+
+    const QDuckdbColumnType &type = d->columns.at(column);
+    const void *values = duckdb_vector_get_data(vector);
+    const idx_t row = d->chunkRow - 1;
+    switch (type.type) {
+    case DUCKDB_TYPE_BOOLEAN:
+        return static_cast<const bool *>(values)[row];
+    case DUCKDB_TYPE_TINYINT:
+        return static_cast<const int8_t *>(values)[row];
+    case DUCKDB_TYPE_SMALLINT:
+        return static_cast<const int16_t *>(values)[row];
+    case DUCKDB_TYPE_INTEGER:
+        return static_cast<const int32_t *>(values)[row];
+    case DUCKDB_TYPE_BIGINT:
+        return static_cast<const int64_t *>(values)[row];
+    case DUCKDB_TYPE_UTINYINT:
+        return static_cast<const uint8_t *>(values)[row];
+    case DUCKDB_TYPE_USMALLINT:
+        return static_cast<const uint16_t *>(values)[row];
+    case DUCKDB_TYPE_UINTEGER:
+        return static_cast<const uint32_t *>(values)[row];
+    case DUCKDB_TYPE_UBIGINT:
+        // saturated like the integer precision policies do
+        return qint64(qMin<quint64>(static_cast<const uint64_t *>(values)[row], std::numeric_limits<qint64>::max()));
+    case DUCKDB_TYPE_FLOAT:
+        return qint64(qBound<double>(-9.2e18, static_cast<const float *>(values)[row], 9.2e18));
+    case DUCKDB_TYPE_DOUBLE:
+        return qint64(qBound<double>(-9.2e18, static_cast<const double *>(values)[row], 9.2e18));
+    case DUCKDB_TYPE_DECIMAL:
+        if (type.storageType != DUCKDB_TYPE_HUGEINT)
+            return qDecimalStorageValue(type.storageType, values, row) / qPowersOfTen[type.scale];
+        break;
+    default:
+        break;
+    }
+    return qColumnValue(type, values, row).toLongLong();
 }
 
-int QDuckdbResult::numRowsAffected()
+double QDuckdbResult::doubleAt(int column) const
 {
     Q_D(const QDuckdbResult);
-    return duckdb_row_count(d->result);
+    const duckdb_vector vector = d->currentVector(column);
+    if (!vector)
+        return const_cast<QDuckdbResult *>(this)->data(column).toDouble();
+    if (isNullAt(column))
+        return 0;
+
+    const QDuckdbColumnType &type = d->columns.at(column);
+    const void *values = duckdb_vector_get_data(vector);
+    const idx_t row = d->chunkRow - 1;
+    switch (type.type) {
+    case DUCKDB_TYPE_FLOAT:
+        return static_cast<const float *>(values)[row];
+    case DUCKDB_TYPE_DOUBLE:
+        return static_cast<const double *>(values)[row];
+    case DUCKDB_TYPE_DECIMAL:
+        if (type.storageType != DUCKDB_TYPE_HUGEINT)
+            return double(qDecimalStorageValue(type.storageType, values, row)) / double(qPowersOfTen[type.scale]);
+        return duckdb_hugeint_to_double(static_cast<const duckdb_hugeint *>(values)[row]) / std::pow(10.0, type.scale);
+    case DUCKDB_TYPE_HUGEINT:
+        return duckdb_hugeint_to_double(static_cast<const duckdb_hugeint *>(values)[row]);
+    default:
+        return double(int64At(column));
+    }
 }
 
-QVariant QDuckdbResult::lastInsertId() const
+// converts UTF-8 into target, plain ASCII reuses the buffer of target
+static void qAssignUtf8(QString &target, const char *data, int size)
+{
+    for (int i = 0; i < size; ++i) {
+        if (uchar(data[i]) >= 0x80) {
+            target = QString::fromUtf8(data, size);
+            return;
+        }
+    }
+    target.resize(size);
+    QChar *out = target.data();
+    for (int i = 0; i < size; ++i)
+        out[i] = QLatin1Char(data[i]);
+}
+
+QStringView QDuckdbResult::stringAt(int column) const
 {
     Q_D(const QDuckdbResult);
-    // if (isActive()) {
-    //     qint64 id = sqlite3_last_insert_rowid(d->drv_d_func()->access);
-    //     if (id)
-    //         return id;
-    // }
-    return QVariant();
+    if (column < 0 || column >= d->stringCells.size())
+        return QStringView();
+    QString &cell = d->stringCells[column];
+    const duckdb_vector vector = d->currentVector(column);
+    if (!vector) {
+        cell = const_cast<QDuckdbResult *>(this)->data(column).toString();
+        return cell;
+    }
+    if (isNullAt(column))
+        return QStringView();
+
+    const QDuckdbColumnType &type = d->columns.at(column);
+    const void *values = duckdb_vector_get_data(vector);
+    const idx_t row = d->chunkRow - 1;
+    switch (type.type) {
+    case DUCKDB_TYPE_VARCHAR: {
+        const duckdb_string_t &str = static_cast<const duckdb_string_t *>(values)[row];
+        qAssignUtf8(cell, QDuckdb::stringData(str), int(str.value.inlined.length));
+        return cell;
+    }
+    case DUCKDB_TYPE_ENUM: {
+        // the dictionary lives as long as the result set
+        const qint64 index = qEnumIndex(type.storageType, values, row);
+        return index < type.keys.size() ? QStringView(type.keys.at(int(index))) : QStringView();
+    }
+    default:
+        cell = qDecodeValue(type, vector, row).toString();
+        return cell;
+    }
 }
 
-QSqlRecord QDuckdbResult::record() const
+QVariant QDuckdbResult::handle() const
 {
     Q_D(const QDuckdbResult);
-    if (!isActive() || !isSelect())
-        return QSqlRecord();
-    return d->rInf;
+    return QVariant::fromValue(d->stmt);
 }
 
-void QDuckdbResult::detachFromResultSet()
+duckdb_result *QDuckdbResult::resultHandle() const
 {
-    Q_D(QDuckdbResult);
-    if (d->stmt)
-        duckdb_clear_bindings(*d->stmt);//sqlite3_reset(d->stmt);
+    Q_D(const QDuckdbResult);
+    if (!isActive())
+        return nullptr;
+    return d->result;
 }
 
-QVariant QDuckdbResult::handle() const
+bool QDuckdbResult::readGadgets(const QMetaObject &metaObject, const std::function<void *()> &append) const
 {
     Q_D(const QDuckdbResult);
-    return QVariant::fromValue(d->stmt);
+    duckdb_result *res = resultHandle();
+    if (!res)
+        return false;
+
+    // columns are matched to properties by name once per gadget type and set of column names
+    QDuckdbDriverPrivate *drv = const_cast<QDuckdbDriverPrivate *>(d->drv_d_func());
+    const idx_t columnCount = duckdb_column_count(res);
+    QString key;
+    for (idx_t i = 0; i < columnCount; ++i)
+        key += QString::fromUtf8(duckdb_column_name(res, i)) + QLatin1Char('\0');
+    QVector<QDuckdbGadgetProperty> properties;
+    if (!drv->cachedGadgetColumns(&metaObject, key, &properties)) {
+        for (idx_t i = 0; i < columnCount; ++i)
+            properties.append(QDuckdbGadgetProperty(metaObject.property(metaObject.indexOfProperty(duckdb_column_name(res, i)))));
+        drv->cacheGadgetColumns(&metaObject, key, properties);
+    }
+
+    // the chunks are released below, so BLOBs are always copied
+    QVector<QDuckdbColumnType> columns = d->columns;
+    QVector<QDuckdb::Column> decoded;
+    QVector<bool> typed;
+    for (int i = 0; i < columns.size(); ++i) {
+        QDuckdbColumnType &column = columns[i];
+        qSetRawData(column, false);
+        decoded.append({ column.type, column.storageType, quint8(column.scale) });
+        typed.append(i < properties.size() && properties.at(i).decodes(column));
+    }
+
+    QVector<duckdb_vector> vectors(properties.size());
+    QVector<const uint64_t *> validity(properties.size());
+    QVector<const void *> data(properties.size());
+    const idx_t chunkCount = duckdb_result_chunk_count(*res);
+    for (idx_t c = 0; c < chunkCount; ++c) {
+        duckdb_data_chunk chunk = duckdb_result_get_chunk(*res, c);
+        if (!chunk)
+            return false;
+        for (int i = 0; i < properties.size(); ++i) {
+            vectors[i] = duckdb_data_chunk_get_vector(chunk, i);
+            if (!vectors.at(i)) {
+                duckdb_destroy_data_chunk(&chunk);
+                return false;
+            }
+            validity[i] = duckdb_vector_get_validity(vectors.at(i));
+            data[i] = duckdb_vector_get_data(vectors.at(i));
+        }
+        const idx_t size = duckdb_data_chunk_get_size(chunk);
+        for (idx_t row = 0; row < size; ++row) {
+            void *gadget = append();
+            for (int i = 0; i < properties.size(); ++i) {
+                const QDuckdbGadgetProperty &property = properties.at(i);
+                if (!property.isValid() || !QDuckdb::Private::isValid(validity.at(i), row))
+                    continue;
+                if (typed.at(i))
+                    property.decode(gadget, decoded.at(i), data.at(i), row);
+                else
+                    property.property.writeOnGadget(gadget, qDecodeValue(columns.at(i), vectors.at(i), row));
+            }
+        }
+        duckdb_destroy_data_chunk(&chunk);
+    }
+    return true;
 }
 
 /////////////////////////////////////////////////////////
@@ -674,7 +3583,14 @@ QDuckdbDriver::QDuckdbDriver(duckdb_database *connection, QObject *parent)
     : QSqlDriver(*new QDuckdbDriverPrivate, parent)
 {
     Q_D(QDuckdbDriver);
-    d->access = connection;
+    d->database = QDuckdbDatabase::adopt(*connection);
+    if (duckdb_connect(*connection, d->conn) == DuckDBError) {
+        setLastError(qMakeError(tr("Error connection to database"), "", QSqlError::ConnectionError, -1));
+        d->database->release();
+        d->database = nullptr;
+        setOpenError(true);
+        return;
+    }
     setOpen(true);
     setOpenError(false);
 }
@@ -698,10 +3614,10 @@ bool QDuckdbDriver::hasFeature(DriverFeature f) const
     case FinishQuery:
     case LowPrecisionNumbers:
     case EventNotifications:
+    case MultipleResultSets:
         return true;
     case QuerySize:
     case BatchOperations:
-    case MultipleResultSets:
     case CancelQuery:
         return false;
     case NamedPlaceholders:
@@ -730,6 +3646,14 @@ bool QDuckdbDriver::open(const QString & db, const QString &, const QString &, c
     bool sharedCache = false;
     bool openReadOnlyOption = false;
     bool openUriOption = false;
+    bool zeroCopyBlobs = false;
+    bool internStrings = false;
+    int groupCommitWindow = 0;
+    static const QLatin1String checkpointWalOption = QLatin1String("QDUCKDB_CHECKPOINT_WAL_SIZE");
+    static const QLatin1String checkpointIdleOption = QLatin1String("QDUCKDB_CHECKPOINT_IDLE");
+    qint64 checkpointWalSize = 0;
+    int checkpointIdle = 0;
+    int notifyInterval = 100;
 #if QT_CONFIG(regularexpression)
     static const QLatin1String regexpConnectOption = QLatin1String("QDUCKDB_ENABLE_REGEXP");
     bool defineRegexp = false;
@@ -753,6 +3677,42 @@ bool QDuckdbDriver::open(const QString & db, const QString &, const QString &, c
             openUriOption = true;
         } else if (option == QLatin1String("QDUCKDB_ENABLE_SHARED_CACHE")) {
             sharedCache = true;
+        } else if (option == QLatin1String("QDUCKDB_ZERO_COPY_BLOBS")) {
+            zeroCopyBlobs = true;
+        } else if (option == QLatin1String("QDUCKDB_INTERN_STRINGS")) {
+            internStrings = true;
+        } else if (option.startsWith(QLatin1String("QDUCKDB_GROUP_COMMIT"))) {
+            option = option.mid(20).trimmed();
+            if (option.startsWith(QLatin1Char('='))) {
+                bool ok;
+                const int window = option.mid(1).trimmed().toInt(&ok);
+                if (ok && window > 0)
+                    groupCommitWindow = window;
+            }
+        } else if (option.startsWith(QLatin1String("QDUCKDB_NOTIFY_INTERVAL"))) {
+            option = option.mid(23).trimmed();
+            if (option.startsWith(QLatin1Char('='))) {
+                bool ok;
+                const int interval = option.mid(1).trimmed().toInt(&ok);
+                if (ok && interval >= 0)
+                    notifyInterval = interval;
+            }
+        } else if (option.startsWith(checkpointWalOption)) {
+            option = option.mid(checkpointWalOption.size()).trimmed();
+            if (option.startsWith(QLatin1Char('='))) {
+                bool ok;
+                const qint64 size = option.mid(1).trimmed().toLongLong(&ok);
+                if (ok && size > 0)
+                    checkpointWalSize = size;
+            }
+        } else if (option.startsWith(checkpointIdleOption)) {
+            option = option.mid(checkpointIdleOption.size()).trimmed();
+            if (option.startsWith(QLatin1Char('='))) {
+                bool ok;
+                const int idle = option.mid(1).trimmed().toInt(&ok);
+                if (ok && idle > 0)
+                    checkpointIdle = idle;
+            }
         }
 #if QT_CONFIG(regularexpression)
         else if (option.startsWith(regexpConnectOption)) {
@@ -787,224 +3747,983 @@ bool QDuckdbDriver::open(const QString & db, const QString &, const QString &, c
     else
         duckdb_set_config(config, "access_mode", "READ_WRITE"); // or READ_ONLY
 
-    //     int openMode = (openReadOnlyOption ? SQLITE_OPEN_READONLY : (SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE));
-    //     openMode |= (sharedCache ? SQLITE_OPEN_SHAREDCACHE : SQLITE_OPEN_PRIVATECACHE);
-    //     openMode |= SQLITE_OPEN_NOMUTEX;
+    //     int openMode = (openReadOnlyOption ? SQLITE_OPEN_READONLY : (SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE));
+    //     openMode |= (sharedCache ? SQLITE_OPEN_SHAREDCACHE : SQLITE_OPEN_PRIVATECACHE);
+    //     openMode |= SQLITE_OPEN_NOMUTEX;
+
+
+    QString msg{};
+    int res=0;
+    do{
+        // a file already opened by another connection is shared, not opened again
+        d->database = QDuckdbDatabase::acquire(db, config, openReadOnlyOption, &msg);
+        if (!d->database)
+        {
+            res = DuckDBError;
+            setLastError(QSqlError(tr("Error opening database"), msg, QSqlError::ConnectionError, QString::number(-1)));
+            setOpenError(true);
+            break;
+        }
+
+        res = duckdb_connect(*d->database->handle(), d->conn);
+        if (res == DuckDBError)
+        {
+            duckdb_disconnect(d->conn);
+            setLastError(qMakeError(tr("Error connection to database"),"", QSqlError::ConnectionError, -1));
+            d->database->release();
+            d->database = nullptr;
+            setOpenError(true);
+            break;
+        }
+        d->zeroCopyBlobs = zeroCopyBlobs;
+        d->internStrings = internStrings;
+        d->groupCommitWindow = groupCommitWindow;
+        d->busyTimeout = timeOut;
+        d->notificationInterval = notifyInterval;
+        if (checkpointWalSize > 0 || checkpointIdle > 0) {
+            // the database keeps checkpointing after this connection is gone, a failure is not fatal
+            QString error;
+            if (!d->database->startCheckpoints(checkpointWalSize, checkpointIdle, &error))
+                qWarning("QDuckdbDriver: background checkpoints not started: %s", qPrintable(error));
+        }
+        setOpen(true);
+        setOpenError(false);
+    } while(false);
+
+    duckdb_destroy_config(&config);
+    return res == DuckDBSuccess;
+}
+
+void QDuckdbDriver::close()
+{
+    Q_D(QDuckdbDriver);
+    if (isOpen()) {
+        for (QDuckdbResult *result : qAsConst(d->results))
+            result->d_func()->finalize();
+
+        if (d->notificationid.count() > 0) {
+            d->database->removeListener(d);
+            QMutexLocker locker(&d->notificationMutex);
+            d->notificationid.clear();
+            d->pendingNotifications.clear();
+            d->lastNotified.clear();
+        }
+
+        // an unfinished grouped transaction is rolled back like any other
+        if (d->commitGroup)
+            d->leaveCommitGroup(false, nullptr);
+        d->endTransaction(false);
+        // the database itself is closed with its last connection
+        duckdb_disconnect(d->conn);
+        if (d->database) {
+            d->database->release();
+            d->database = nullptr;
+        }
+        d->temporaryLoaded = false;
+        d->temporaryInfo.clear();
+        // the views scanning them went with the connection
+        d->arrowIpcViews.clear();
+        setOpen(false);
+        setOpenError(false);
+    }
+}
+
+QSqlResult *QDuckdbDriver::createResult() const
+{
+    return new QDuckdbResult(this);
+}
+
+bool QDuckdbDriver::beginTransaction()
+{
+    Q_D(QDuckdbDriver);
+    if (!isOpen() || isOpenError())
+        return false;
+
+    // grouped transactions run their statements on the connection of the group
+    if (d->groupCommitWindow > 0) {
+        QString message;
+        d->commitGroup = d->database->joinCommitGroup(d->groupCommitWindow, &d->commitMember, &message);
+        if (!d->commitGroup) {
+            setLastError(QSqlError(tr("Unable to begin transaction"),
+                                   message, QSqlError::TransactionError));
+            return false;
+        }
+        d->conn = &d->commitGroup->connection;
+        d->inTransaction = true;
+        return true;
+    }
+
+    QSqlQuery q(createResult());
+    if (!q.exec(QLatin1String("BEGIN"))) {
+        setLastError(QSqlError(tr("Unable to begin transaction"),
+                               q.lastError().databaseText(), QSqlError::TransactionError));
+        return false;
+    }
+
+    d->inTransaction = true;
+    return true;
+}
+
+bool QDuckdbDriver::commitTransaction()
+{
+    Q_D(QDuckdbDriver);
+    if (!isOpen() || isOpenError())
+        return false;
+
+    if (d->commitGroup) {
+        QString message;
+        if (!d->leaveCommitGroup(true, &message)) {
+            setLastError(QSqlError(tr("Unable to commit transaction"),
+                                   message, QSqlError::TransactionError));
+            return false;
+        }
+        return true;
+    }
+
+    // a failed commit rolls back, its changes are not notified
+    QSqlQuery q(createResult());
+    const bool committed = q.exec(QLatin1String("COMMIT"));
+    d->endTransaction(committed);
+    if (!committed) {
+        setLastError(QSqlError(tr("Unable to commit transaction"),
+                               q.lastError().databaseText(), QSqlError::TransactionError));
+        return false;
+    }
+
+    return true;
+}
+
+bool QDuckdbDriver::rollbackTransaction()
+{
+    Q_D(QDuckdbDriver);
+    if (!isOpen() || isOpenError())
+        return false;
+
+    // only the writes of this member leave the group
+    if (d->commitGroup) {
+        d->leaveCommitGroup(false, nullptr);
+        return true;
+    }
+
+    d->endTransaction(false);
+    QSqlQuery q(createResult());
+    if (!q.exec(QLatin1String("ROLLBACK"))) {
+        setLastError(QSqlError(tr("Unable to rollback transaction"),
+                               q.lastError().databaseText(), QSqlError::TransactionError));
+        return false;
+    }
+
+    return true;
+}
+
+/*
+   DuckDB aborts the later of two transactions writing the same rows. Such a
+   conflict is retried after a pause that doubles with every attempt, half of
+   it random so that the writers that collided do not collide again.
+*/
+bool QDuckdbDriver::runTransaction(const std::function<bool()> &work, int maxRetries)
+{
+    Q_D(QDuckdbDriver);
+    for (int attempt = 0;; ++attempt) {
+        d->lastErrorType = DUCKDB_ERROR_INVALID;
+        if (!beginTransaction())
+            return false;
+        // a failed commit has already rolled the transaction back
+        if (!work()) {
+            rollbackTransaction();
+        } else if (commitTransaction()) {
+            return true;
+        }
+
+        if (d->lastErrorType != DUCKDB_ERROR_TRANSACTION)
+            return false;
+        if (attempt >= maxRetries) {
+            ++d->transactionAborts;
+            return false;
+        }
+        ++d->transactionRetries;
+        const int pause = 1000 << qMin(attempt, 7);
+        QThread::usleep(pause / 2 + QRandomGenerator::global()->bounded(pause / 2));
+    }
+}
+
+QDuckdbDriver::CheckpointStats QDuckdbDriver::checkpointStats() const
+{
+    Q_D(const QDuckdbDriver);
+    CheckpointStats stats = {};
+    if (!d->database)
+        return stats;
+    stats.walSize = d->database->walSize();
+    stats.checkpoints = d->database->checkpoints.loadRelaxed();
+    stats.failedCheckpoints = d->database->failedCheckpoints.loadRelaxed();
+    stats.lastCheckpointMSecs = d->database->lastCheckpointMSecs.loadRelaxed();
+    stats.maxCheckpointMSecs = d->database->maxCheckpointMSecs.loadRelaxed();
+    return stats;
+}
+
+quint64 QDuckdbDriver::transactionRetries() const
+{
+    Q_D(const QDuckdbDriver);
+    return d->transactionRetries;
+}
+
+quint64 QDuckdbDriver::transactionAborts() const
+{
+    Q_D(const QDuckdbDriver);
+    return d->transactionAborts;
+}
+
+/*
+   Table lists and table info are cached per database until the next DDL, so
+   table models asking for them repeatedly cost one catalog query per table.
+*/
+QStringList QDuckdbDriver::tables(QSql::TableType type) const
+{
+    Q_D(const QDuckdbDriver);
+    QStringList res;
+    if (!isOpen())
+        return res;
+
+    QDuckdbDriverPrivate *p = const_cast<QDuckdbDriverPrivate *>(d);
+    p->refreshTemporaryTables();
+    if (type & QSql::Tables)
+        res << p->tableNames(QSql::Tables) << p->temporaryTables;
+    if (type & QSql::Views)
+        res << p->tableNames(QSql::Views) << p->temporaryViews;
+    if (type & QSql::SystemTables)
+        res << p->tableNames(QSql::SystemTables);
+    return res;
+}
+
+QSqlIndex QDuckdbDriver::primaryIndex(const QString &tblname) const
+{
+    Q_D(const QDuckdbDriver);
+    if (!isOpen())
+        return QSqlIndex();
+
+    QString table = tblname;
+    if (isIdentifierEscaped(table, QSqlDriver::TableName))
+        table = stripDelimiters(table, QSqlDriver::TableName);
+
+    return qApplyPrecisionPolicy(const_cast<QDuckdbDriverPrivate *>(d)->tableInfo(table).primaryIndex,
+                                 numericalPrecisionPolicy());
+}
+
+QSqlRecord QDuckdbDriver::record(const QString &tbl) const
+{
+    Q_D(const QDuckdbDriver);
+    if (!isOpen())
+        return QSqlRecord();
+
+    QString table = tbl;
+    if (isIdentifierEscaped(table, QSqlDriver::TableName))
+        table = stripDelimiters(table, QSqlDriver::TableName);
+
+    return qApplyPrecisionPolicy(const_cast<QDuckdbDriverPrivate *>(d)->tableInfo(table).record,
+                                 numericalPrecisionPolicy());
+}
+
+/*
+   One catalog query for all the tables instead of one per table; the results
+   also fill the schema cache, under the names tables() reports.
+*/
+bool QDuckdbDriver::readTableInfo(const QString &pattern, QHash<QString, QSqlRecord> *records,
+                                  QHash<QString, QSqlIndex> *primaryIndexes)
+{
+    Q_D(QDuckdbDriver);
+    if (!isOpen() || isOpenError())
+        return false;
+
+    QString sql = QLatin1String("SELECT CASE WHEN c.schema_name = current_schema() THEN c.table_name"
+                                " ELSE c.schema_name || '.' || c.table_name END,"
+                                " c.column_name, c.data_type, c.is_nullable, c.column_default,"
+                                " coalesce(list_contains(k.constraint_column_names, c.column_name), false)"
+                                " FROM duckdb_columns() c LEFT JOIN duckdb_constraints() k"
+                                " ON k.table_oid = c.table_oid AND k.constraint_type = 'PRIMARY KEY'"
+                                " WHERE c.database_name = current_database() AND NOT c.internal");
+    if (!pattern.isEmpty())
+        sql += QLatin1String(" AND c.table_name LIKE ?");
+    sql += QLatin1String(" ORDER BY c.schema_name, c.table_name, c.column_index");
+
+    QDuckdbDatabase *database = d->database;
+    const quint64 version = database->schemaVersion();
+    QSqlQuery q(createResult());
+    q.setForwardOnly(true);
+    q.prepare(sql);
+    if (!pattern.isEmpty())
+        q.addBindValue(pattern);
+    if (!q.exec()) {
+        setLastError(QSqlError(tr("Unable to read table info"), q.lastError().databaseText(),
+                               QSqlError::StatementError));
+        return false;
+    }
+
+    const QSql::NumericalPrecisionPolicy policy = numericalPrecisionPolicy();
+    QString table;
+    QDuckdbTableInfo info;
+    const auto flush = [&]() {
+        if (table.isEmpty())
+            return;
+        if (!d->schemaChanged)
+            database->cacheTable(table, version, info);
+        if (records)
+            records->insert(table, qApplyPrecisionPolicy(info.record, policy));
+        if (primaryIndexes)
+            primaryIndexes->insert(table, qApplyPrecisionPolicy(info.primaryIndex, policy));
+    };
+    while (q.next()) {
+        const QString name = q.value(0).toString();
+        if (name != table) {
+            flush();
+            table = name;
+            info = QDuckdbTableInfo();
+        }
+        qAppendTableField(q, table, &info);
+    }
+    flush();
+    return true;
+}
+
+bool QDuckdbDriver::appendGadgets(const QString &table, const QMetaObject &metaObject,
+                                  const void *gadgets, int count, int stride)
+{
+    Q_D(QDuckdbDriver);
+    if (!isOpen() || isOpenError())
+        return false;
+    // appended rows could not be replayed when another member of the group fails
+    if (d->commitGroup) {
+        setLastError(qMakeError(tr("Unable to append rows"), qGroupedTransactionError,
+                                QSqlError::TransactionError, DuckDBError));
+        return false;
+    }
 
+    QString schema;
+    QString name = table;
+    const int indexOfSeparator = table.indexOf(QLatin1Char('.'));
+    if (indexOfSeparator > -1) {
+        schema = table.left(indexOfSeparator);
+        name = table.mid(indexOfSeparator + 1);
+    }
 
-    char *error_message = nullptr;
-    QString msg{};
-    int res=0;
-    do{
-        res = duckdb_open_ext(db.toUtf8().constData(), d->access,config,&error_message);
-        if (res == DuckDBError)
-        {
-            setLastError(qMakeError(tr("Error opening database"),error_message, QSqlError::ConnectionError, -1));
-            setOpenError(true);
-            break;
+    // the table columns are matched to properties by name once per gadget type and table
+    QVector<QDuckdbGadgetProperty> properties;
+    if (!d->cachedGadgetColumns(&metaObject, table, &properties)) {
+        duckdb_result columns;
+        const QByteArray sql = QByteArray("SELECT * FROM ") + escapeIdentifier(table, TableName).toUtf8()
+                + QByteArray(" LIMIT 0");
+        if (duckdb_query(*d->conn, sql.constData(), &columns) == DuckDBError) {
+            setLastError(qMakeError(tr("Unable to append rows"), duckdb_result_error(&columns),
+                                    QSqlError::StatementError, DuckDBError));
+            duckdb_destroy_result(&columns);
+            return false;
         }
-        // sqlite3_busy_timeout(d->access, timeOut);
+        for (idx_t i = 0; i < duckdb_column_count(&columns); ++i)
+            properties.append(QDuckdbGadgetProperty(metaObject.property(metaObject.indexOfProperty(duckdb_column_name(&columns, i)))));
+        duckdb_destroy_result(&columns);
+        d->cacheGadgetColumns(&metaObject, table, properties);
+    }
 
-        res = duckdb_connect(*d->access, d->conn);
-        if (res == DuckDBError)
-        {
-            duckdb_disconnect(d->conn);
-            setLastError(qMakeError(tr("Error connection to database"),"", QSqlError::ConnectionError, -1));
-            if (d->access) {
-                duckdb_close(d->access);
-                d->access = 0;
-            }
-            setOpenError(true);
-            break;
-        }
-        setOpen(true);
-        setOpenError(false);
-    } while(false);
+    duckdb_appender appender;
+    if (duckdb_appender_create(*d->conn, schema.isEmpty() ? nullptr : schema.toUtf8().constData(),
+                               name.toUtf8().constData(), &appender) == DuckDBError) {
+        setLastError(qMakeError(tr("Unable to append rows"), duckdb_appender_error(appender),
+                                QSqlError::StatementError, DuckDBError));
+        duckdb_appender_destroy(&appender);
+        return false;
+    }
 
-    if(error_message!=nullptr)
-        duckdb_free((void*)error_message);
-    duckdb_destroy_config(&config);
+    int res = DuckDBSuccess;
+    const char *gadget = static_cast<const char *>(gadgets);
+    for (int row = 0; row < count && res == DuckDBSuccess; ++row, gadget += stride) {
+        duckdb_appender_begin_row(appender);
+        for (int i = 0; i < properties.size() && res == DuckDBSuccess; ++i) {
+            if (!properties.at(i).isValid())
+                res = duckdb_append_default(appender);
+            else
+                res = properties.at(i).append(appender, gadget);
+        }
+        if (res == DuckDBSuccess)
+            res = duckdb_appender_end_row(appender);
+    }
+    if (res == DuckDBSuccess)
+        res = duckdb_appender_close(appender);
+    if (res != DuckDBSuccess)
+        setLastError(qMakeError(tr("Unable to append rows"), duckdb_appender_error(appender),
+                                QSqlError::StatementError, res));
+    else
+        d->recordChange(name, count);
+    duckdb_appender_destroy(&appender);
     return res == DuckDBSuccess;
 }
 
-void QDuckdbDriver::close()
+// a queued row, or a request to the writer of a QDuckdbWriteQueue
+struct QDuckdbWriteNode
 {
-    Q_D(QDuckdbDriver);
-    if (isOpen()) {
-        for (QDuckdbResult *result : qAsConst(d->results))
-            result->d_func()->finalize();
+    enum Kind { Row, Flush, FlushNow, Stop };
 
-        if (d->access && (d->notificationid.count() > 0)) {
-            d->notificationid.clear();
-            // sqlite3_update_hook(d->access, NULL, NULL);
-        }
+    QAtomicPointer<QDuckdbWriteNode> next;
+    Kind kind = Row;
+    QVector<QVariant> row;
+    QFutureInterface<bool> flushed;
+};
 
-        // const int res = sqlite3_close(d->access);
+/*
+   The queue is an intrusive multi producer, single consumer list: producers
+   swap their node in at head and then link it to its predecessor, the writer
+   follows the links from tail. The semaphores only count, queued the linked
+   nodes the writer may take and free the rows that may still be queued.
+*/
+class QDuckdbWriteQueuePrivate : public QThread
+{
+public:
+    QDuckdbWriteQueuePrivate(int flushRows, int flushMSecs, int maxPendingRows)
+        : flushRows(qMax(1, flushRows)), flushMSecs(qMax(0, flushMSecs)), free(qMax(1, maxPendingRows))
+    {
+        setObjectName(QStringLiteral("QDuckdbWriteQueue"));
+        tail = new QDuckdbWriteNode;
+        head.storeRelaxed(tail);
+    }
+    ~QDuckdbWriteQueuePrivate();
+
+    bool createAppender();
+    void push(QDuckdbWriteNode *node);
+    QDuckdbWriteNode *pop();
+    bool appendRow(const QVector<QVariant> &row);
+    bool flushAppender(bool failed);
+    bool execute(const char *sql);
+    void setError(const char *message);
+    void run() override;
+
+    QDuckdbDatabase *database = nullptr;
+    duckdb_connection connection = nullptr;
+    duckdb_appender appender = nullptr;
+    // the rows since the last flush are written in a transaction of their own
+    bool inTransaction = false;
+    QByteArray schema;
+    QByteArray table;
+    QStringList columns;
+    const int flushRows;
+    const int flushMSecs;
+
+    QAtomicPointer<QDuckdbWriteNode> head;
+    QDuckdbWriteNode *tail;
+    QSemaphore queued;
+    QSemaphore free;
+
+    mutable QMutex errorMutex;
+    QSqlError error;
+    QReadWriteLock gadgetLock;
+    QHash<const QMetaObject *, QVector<QDuckdbGadgetProperty>> gadgetProperties;
+};
 
-        // if (res != SQLITE_OK)
-        //     setLastError(qMakeError(d->access, tr("Error closing database"), QSqlError::ConnectionError, res));
-        d->access = 0;
-        setOpen(false);
-        setOpenError(false);
+QDuckdbWriteQueuePrivate::~QDuckdbWriteQueuePrivate()
+{
+    if (appender)
+        duckdb_appender_destroy(&appender);
+    if (connection)
+        duckdb_disconnect(&connection);
+    if (database)
+        database->release();
+    while (tail) {
+        QDuckdbWriteNode *next = tail->next.loadAcquire();
+        delete tail;
+        tail = next;
     }
 }
 
-QSqlResult *QDuckdbDriver::createResult() const
+bool QDuckdbWriteQueuePrivate::createAppender()
 {
-    return new QDuckdbResult(this);
+    if (duckdb_appender_create(connection, schema.isEmpty() ? nullptr : schema.constData(),
+                               table.constData(), &appender) == DuckDBSuccess)
+        return true;
+    setError(duckdb_appender_error(appender));
+    duckdb_appender_destroy(&appender);
+    appender = nullptr;
+    return false;
 }
 
-bool QDuckdbDriver::beginTransaction()
+void QDuckdbWriteQueuePrivate::push(QDuckdbWriteNode *node)
 {
-    if (!isOpen() || isOpenError())
-        return false;
+    QDuckdbWriteNode *previous = head.fetchAndStoreAcquire(node);
+    previous->next.storeRelease(node);
+    queued.release();
+}
 
-    QSqlQuery q(createResult());
-    if (!q.exec(QLatin1String("BEGIN"))) {
-        setLastError(QSqlError(tr("Unable to begin transaction"),
-                               q.lastError().databaseText(), QSqlError::TransactionError));
+// the returned node is the new tail, its payload is taken but the node stays
+QDuckdbWriteNode *QDuckdbWriteQueuePrivate::pop()
+{
+    QDuckdbWriteNode *next;
+    // a producer may have swapped its node in without having linked it yet
+    while (!(next = tail->next.loadAcquire()))
+        QThread::yieldCurrentThread();
+    delete tail;
+    tail = next;
+    return next;
+}
+
+bool QDuckdbWriteQueuePrivate::appendRow(const QVector<QVariant> &row)
+{
+    if (!appender)
         return false;
+    if (!inTransaction) {
+        if (!execute("BEGIN TRANSACTION"))
+            return false;
+        inTransaction = true;
     }
+    duckdb_state res = duckdb_appender_begin_row(appender);
+    for (int i = 0; i < columns.size() && res == DuckDBSuccess; ++i) {
+        if (i < row.size() && row.at(i).isValid())
+            res = qAppendValue(appender, row.at(i));
+        else
+            res = duckdb_append_default(appender);
+    }
+    if (res == DuckDBSuccess)
+        res = duckdb_appender_end_row(appender);
+    if (res != DuckDBSuccess)
+        setError(duckdb_appender_error(appender));
+    return res == DuckDBSuccess;
+}
 
-    return true;
+/*
+   The rows appended since the last flush are committed together. After a
+   failure, whether of a row, the flush or the commit, none of them is written:
+   the appender is replaced without being used again, and whatever destroying
+   it flushes goes into the transaction that is rolled back. Callers may thus
+   queue the rows of a failed flush again.
+*/
+bool QDuckdbWriteQueuePrivate::flushAppender(bool failed)
+{
+    database->noteActivity();
+    if (!failed && appender) {
+        if (duckdb_appender_flush(appender) == DuckDBSuccess) {
+            if (!inTransaction)
+                return true;
+            // a failed commit has rolled back already
+            inTransaction = false;
+            return execute("COMMIT");
+        }
+        setError(duckdb_appender_error(appender));
+    }
+    if (appender)
+        duckdb_appender_destroy(&appender);
+    appender = nullptr;
+    if (inTransaction) {
+        duckdb_result result;
+        duckdb_query(connection, "ROLLBACK", &result);
+        duckdb_destroy_result(&result);
+        inTransaction = false;
+    }
+    createAppender();
+    return false;
 }
 
-bool QDuckdbDriver::commitTransaction()
+bool QDuckdbWriteQueuePrivate::execute(const char *sql)
 {
-    if (!isOpen() || isOpenError())
-        return false;
+    duckdb_result result;
+    const bool ok = duckdb_query(connection, sql, &result) == DuckDBSuccess;
+    if (!ok)
+        setError(duckdb_result_error(&result));
+    duckdb_destroy_result(&result);
+    return ok;
+}
 
-    QSqlQuery q(createResult());
-    if (!q.exec(QLatin1String("COMMIT"))) {
-        setLastError(QSqlError(tr("Unable to commit transaction"),
-                               q.lastError().databaseText(), QSqlError::TransactionError));
-        return false;
+void QDuckdbWriteQueuePrivate::setError(const char *message)
+{
+    QMutexLocker locker(&errorMutex);
+    error = qMakeError(QCoreApplication::translate("QDuckdbWriteQueue", "Unable to append rows"),
+                       message ? message : "", QSqlError::StatementError, DuckDBError);
+}
+
+void QDuckdbWriteQueuePrivate::run()
+{
+    QVector<QFutureInterface<bool>> waiting;
+    QElapsedTimer pendingSince;
+    int appended = 0;
+    bool failed = false;
+    bool stop = false;
+    while (!stop) {
+        const bool pending = appended > 0 || !waiting.isEmpty();
+        int count = 0;
+        if (!pending) {
+            queued.acquire();
+            count = 1;
+        } else if (queued.tryAcquire(1, int(qMax<qint64>(0, flushMSecs - pendingSince.elapsed())))) {
+            count = 1;
+        }
+        // whatever was queued meanwhile is taken in the same pass
+        const int more = count ? queued.available() : 0;
+        if (more > 0 && queued.tryAcquire(more))
+            count += more;
+
+        bool flushNow = false;
+        for (int i = 0; i < count; ++i) {
+            QDuckdbWriteNode *node = pop();
+            if (appended == 0 && waiting.isEmpty())
+                pendingSince.start();
+            switch (node->kind) {
+            case QDuckdbWriteNode::Row: {
+                const QVector<QVariant> row = std::move(node->row);
+                if (!failed)
+                    failed = !appendRow(row);
+                ++appended;
+                break;
+            }
+            case QDuckdbWriteNode::FlushNow:
+                flushNow = true;
+                Q_FALLTHROUGH();
+            case QDuckdbWriteNode::Flush:
+                waiting.append(node->flushed);
+                node->flushed = QFutureInterface<bool>();
+                break;
+            case QDuckdbWriteNode::Stop:
+                flushNow = true;
+                stop = true;
+                break;
+            }
+        }
+
+        if (flushNow || appended >= flushRows
+            || ((appended > 0 || !waiting.isEmpty()) && pendingSince.elapsed() >= flushMSecs)) {
+            const bool ok = flushAppender(failed);
+            if (ok && appended > 0 && database->hasListeners())
+                database->notifyChange(QString::fromUtf8(table), appended, nullptr);
+            if (appended > 0)
+                free.release(appended);
+            appended = 0;
+            failed = false;
+            for (QFutureInterface<bool> &flushed : waiting) {
+                flushed.reportResult(ok);
+                flushed.reportFinished();
+            }
+            waiting.clear();
+        }
     }
+}
 
-    return true;
+QDuckdbWriteQueue::QDuckdbWriteQueue(QDuckdbWriteQueuePrivate *d)
+    : d(d)
+{
 }
 
-bool QDuckdbDriver::rollbackTransaction()
+QDuckdbWriteQueue::~QDuckdbWriteQueue()
 {
-    if (!isOpen() || isOpenError())
-        return false;
+    QDuckdbWriteNode *node = new QDuckdbWriteNode;
+    node->kind = QDuckdbWriteNode::Stop;
+    d->push(node);
+    d->wait();
+    delete d;
+}
 
-    QSqlQuery q(createResult());
-    if (!q.exec(QLatin1String("ROLLBACK"))) {
-        setLastError(QSqlError(tr("Unable to rollback transaction"),
-                               q.lastError().databaseText(), QSqlError::TransactionError));
+bool QDuckdbWriteQueue::enqueue(const QVector<QVariant> &row, int timeout)
+{
+    return enqueue(QVector<QVariant>(row), timeout);
+}
+
+bool QDuckdbWriteQueue::enqueue(QVector<QVariant> &&row, int timeout)
+{
+    if (row.size() > d->columns.size())
+        return false;
+    // back-pressure: the writer frees the slots of the rows it has flushed
+    if (timeout < 0)
+        d->free.acquire();
+    else if (!d->free.tryAcquire(1, timeout))
         return false;
+    QDuckdbWriteNode *node = new QDuckdbWriteNode;
+    node->row = std::move(row);
+    d->push(node);
+    return true;
+}
+
+bool QDuckdbWriteQueue::enqueueGadget(const QMetaObject &metaObject, const void *gadget, int timeout)
+{
+    QVector<QDuckdbGadgetProperty> properties;
+    {
+        QReadLocker locker(&d->gadgetLock);
+        properties = d->gadgetProperties.value(&metaObject);
+    }
+    if (properties.isEmpty()) {
+        for (const QString &column : qAsConst(d->columns))
+            properties.append(QDuckdbGadgetProperty(metaObject.property(metaObject.indexOfProperty(column.toUtf8().constData()))));
+        QWriteLocker locker(&d->gadgetLock);
+        d->gadgetProperties.insert(&metaObject, properties);
     }
 
-    return true;
+    QVector<QVariant> row(properties.size());
+    for (int i = 0; i < properties.size(); ++i) {
+        if (properties.at(i).isValid())
+            row[i] = properties.at(i).readVariant(gadget);
+    }
+    return enqueue(std::move(row), timeout);
 }
 
-QStringList QDuckdbDriver::tables(QSql::TableType type) const
+QFuture<bool> QDuckdbWriteQueue::flush(bool immediately)
 {
-    QStringList res;
-    if (!isOpen())
-        return res;
+    QDuckdbWriteNode *node = new QDuckdbWriteNode;
+    node->kind = immediately ? QDuckdbWriteNode::FlushNow : QDuckdbWriteNode::Flush;
+    node->flushed.reportStarted();
+    const QFuture<bool> future = node->flushed.future();
+    d->push(node);
+    return future;
+}
 
-    QSqlQuery q(createResult());
-    q.setForwardOnly(true);
+QStringList QDuckdbWriteQueue::columns() const
+{
+    return d->columns;
+}
 
-    QString sql = QLatin1String("SELECT name FROM sqlite_master WHERE %1 "
-                                "UNION ALL SELECT name FROM sqlite_temp_master WHERE %1");
-    if ((type & QSql::Tables) && (type & QSql::Views))
-        sql = sql.arg(QLatin1String("type='table' OR type='view'"));
-    else if (type & QSql::Tables)
-        sql = sql.arg(QLatin1String("type='table'"));
-    else if (type & QSql::Views)
-        sql = sql.arg(QLatin1String("type='view'"));
-    else
-        sql.clear();
+QSqlError QDuckdbWriteQueue::lastError() const
+{
+    QMutexLocker locker(&d->errorMutex);
+    return d->error;
+}
 
-    if (!sql.isEmpty() && q.exec(sql)) {
-        while(q.next())
-            res.append(q.value(0).toString());
-    }
+QDuckdbWriteQueue *QDuckdbDriver::createWriteQueue(const QString &table, int flushRows, int flushMSecs,
+                                                   int maxPendingRows)
+{
+    Q_D(QDuckdbDriver);
+    if (!isOpen() || isOpenError())
+        return nullptr;
 
-    if (type & QSql::SystemTables) {
-        // there are no internal tables beside this one:
-        res.append(QLatin1String("sqlite_master"));
+    QScopedPointer<QDuckdbWriteQueuePrivate> queue(new QDuckdbWriteQueuePrivate(flushRows, flushMSecs, maxPendingRows));
+    const int indexOfSeparator = table.indexOf(QLatin1Char('.'));
+    if (indexOfSeparator > -1) {
+        queue->schema = table.left(indexOfSeparator).toUtf8();
+        queue->table = table.mid(indexOfSeparator + 1).toUtf8();
+    } else {
+        queue->table = table.toUtf8();
     }
 
-    return res;
+    duckdb_result columns;
+    const QByteArray sql = QByteArray("SELECT * FROM ") + escapeIdentifier(table, TableName).toUtf8()
+            + QByteArray(" LIMIT 0");
+    QMutexLocker lock(d->connectionMutex());
+    if (duckdb_query(*d->conn, sql.constData(), &columns) == DuckDBError) {
+        setLastError(qMakeError(tr("Unable to create write queue"), duckdb_result_error(&columns),
+                                QSqlError::StatementError, DuckDBError));
+        duckdb_destroy_result(&columns);
+        return nullptr;
+    }
+    for (idx_t i = 0; i < duckdb_column_count(&columns); ++i)
+        queue->columns.append(QString::fromUtf8(duckdb_column_name(&columns, i)));
+    duckdb_destroy_result(&columns);
+    lock.unlock();
+
+    // the writer has a connection of its own, so the queue may outlive this one
+    d->database->retain();
+    queue->database = d->database;
+    if (duckdb_connect(*d->database->handle(), &queue->connection) == DuckDBError) {
+        queue->connection = nullptr;
+        setLastError(qMakeError(tr("Unable to create write queue"), "", QSqlError::ConnectionError, DuckDBError));
+        return nullptr;
+    }
+    if (!queue->createAppender()) {
+        setLastError(queue->error);
+        return nullptr;
+    }
+    queue->start();
+    return new QDuckdbWriteQueue(queue.take());
 }
 
-static QSqlIndex qGetTableInfo(QSqlQuery &q, const QString &tableName, bool onlyPIndex = false)
+/*
+   The script is split once and each statement is prepared right before it
+   runs, so later statements see the tables created by earlier ones. Nothing
+   is materialized for the caller, only the change count is kept.
+*/
+bool QDuckdbDriver::runScript(const QString &script, QVector<ScriptStatement> *statements)
 {
-    QString schema;
-    QString table(tableName);
-    const int indexOfSeparator = tableName.indexOf(QLatin1Char('.'));
-    if (indexOfSeparator > -1) {
-        const int indexOfCloseBracket = tableName.indexOf(QLatin1Char(']'));
-        if (indexOfCloseBracket != tableName.size() - 1) {
-            // Handles a case like databaseName.tableName
-            schema = tableName.left(indexOfSeparator + 1);
-            table = tableName.mid(indexOfSeparator + 1);
+    Q_D(QDuckdbDriver);
+    if (!isOpen() || isOpenError())
+        return false;
+
+    QMutexLocker lock(d->connectionMutex());
+    if (!d->commitMemberActive()) {
+        setLastError(qMakeError(tr("Unable to run script"), qGroupedTransactionDropped,
+                                QSqlError::TransactionError, DuckDBError));
+        return false;
+    }
+    const QByteArray text = script.toUtf8();
+    duckdb_extracted_statements extracted = nullptr;
+    const idx_t count = duckdb_extract_statements(*d->conn, text.constData(), &extracted);
+    if (count == 0) {
+        const char *message = duckdb_extract_statements_error(extracted);
+        setLastError(qMakeError(tr("Unable to run script"), message ? message : "",
+                                QSqlError::StatementError, DuckDBError));
+        duckdb_destroy_extracted(&extracted);
+        return false;
+    }
+
+    bool ok = true;
+    QElapsedTimer timer;
+    // the steps of its transaction statements and the tables it writes, scanned once when first needed
+    QVector<QDuckdbTransactionStep> transactionSteps;
+    QStringList changedTables;
+    bool scanned = false;
+    const auto scan = [&]() {
+        if (!scanned)
+            qScanScript(script, count, &transactionSteps, &changedTables);
+        scanned = true;
+    };
+    for (idx_t i = 0; i < count && ok; ++i) {
+        timer.start();
+        duckdb_prepared_statement stmt;
+        if (duckdb_prepare_extracted_statement(*d->conn, extracted, i, &stmt) == DuckDBError) {
+            setLastError(qMakeError(tr("Unable to run statement %1 of script").arg(i + 1),
+                                    duckdb_prepare_error(stmt), QSqlError::StatementError, DuckDBError));
+            duckdb_destroy_prepare(&stmt);
+            d->statementFailed();
+            ok = false;
+            break;
+        }
+        const duckdb_statement_type type = duckdb_prepared_statement_type(stmt);
+        duckdb_result result;
+        d->rewindArrowIpcViews();
+        if (duckdb_execute_prepared(stmt, &result) == DuckDBError) {
+            setLastError(qMakeError(tr("Unable to run statement %1 of script").arg(i + 1),
+                                    duckdb_result_error(&result), QSqlError::StatementError, DuckDBError));
+            d->lastErrorType = duckdb_result_error_type(&result);
+            d->statementFailed();
+            ok = false;
         } else {
-            const int indexOfOpenBracket = tableName.lastIndexOf(QLatin1Char('['), indexOfCloseBracket);
-            if (indexOfOpenBracket > 0) {
-                // Handles a case like databaseName.[tableName]
-                schema = tableName.left(indexOfOpenBracket);
-                table = tableName.mid(indexOfOpenBracket);
+            if (type != DUCKDB_STATEMENT_TYPE_SELECT)
+                d->logGroupStatement(text, i, QVector<QVariant>());
+            QDuckdbTransactionStep step = QDuckdbNoTransactionStep;
+            if (type == DUCKDB_STATEMENT_TYPE_TRANSACTION) {
+                scan();
+                if (i < idx_t(transactionSteps.size()))
+                    step = transactionSteps.at(int(i));
+            }
+            d->statementExecuted(type, step);
+            if (type == DUCKDB_STATEMENT_TYPE_INSERT || type == DUCKDB_STATEMENT_TYPE_UPDATE
+                || type == DUCKDB_STATEMENT_TYPE_DELETE || type == DUCKDB_STATEMENT_TYPE_COPY) {
+                if (d->database->hasListeners())
+                    scan();
+                if (idx_t(changedTables.size()) == count)
+                    d->recordChange(changedTables.at(int(i)), qint64(duckdb_rows_changed(&result)));
             }
+            if (statements)
+                statements->append({ type, qint64(duckdb_rows_changed(&result)), timer.nsecsElapsed() });
         }
+        duckdb_destroy_result(&result);
+        duckdb_destroy_prepare(&stmt);
+    }
+    duckdb_destroy_extracted(&extracted);
+    return ok;
+}
+
+// DuckDB 1.1.3 reports no reason for a failed Arrow scan, the schema is then the usual cause
+static const char qArrowScanError[] = "the Arrow schema could not be read or has a type DuckDB cannot scan";
+
+bool QDuckdbDriver::registerArrowStream(const QString &name, ArrowArrayStream *stream)
+{
+    Q_D(QDuckdbDriver);
+    if (!isOpen() || isOpenError())
+        return false;
+    if (d->commitGroup) {
+        setLastError(qMakeError(tr("Unable to register Arrow data"), qGroupedTransactionError,
+                                QSqlError::TransactionError, DuckDBError));
+        return false;
     }
-    q.exec(QLatin1String("PRAGMA ") + schema + QLatin1String("table_info (") +
-           _q_escapeIdentifier(table, QSqlDriver::TableName) + QLatin1Char(')'));
-    QSqlIndex ind;
-    while (q.next()) {
-        bool isPk = q.value(5).toInt();
-        if (onlyPIndex && !isPk)
-            continue;
-        QString typeName = q.value(2).toString().toLower();
-        QString defVal = q.value(4).toString();
-        if (!defVal.isEmpty() && defVal.at(0) == QLatin1Char('\'')) {
-            const int end = defVal.lastIndexOf(QLatin1Char('\''));
-            if (end > 0)
-                defVal = defVal.mid(1, end - 1);
-        }
 
-        QSqlField fld(q.value(1).toString(), qGetColumnType(typeName), tableName);
-        if (isPk && (typeName == QLatin1String("integer")))
-            // INTEGER PRIMARY KEY fields are auto-generated in sqlite
-            // INT PRIMARY KEY is not the same as INTEGER PRIMARY KEY!
-            fld.setAutoValue(true);
-        fld.setRequired(q.value(3).toInt() != 0);
-        fld.setDefaultValue(defVal);
-        ind.append(fld);
+    const QByteArray view = "qt_arrow_scan_" + QByteArray::number(quintptr(stream), 16);
+    if (duckdb_arrow_scan(*d->conn, view.constData(), reinterpret_cast<duckdb_arrow_stream>(stream)) == DuckDBError) {
+        // DuckDB drops the reason of a failed scan, the stream keeps its own when reading the schema failed
+        const char *error = stream->get_last_error ? stream->get_last_error(stream) : nullptr;
+        setLastError(qMakeError(tr("Unable to register Arrow data"),
+                                error && *error ? error : qArrowScanError,
+                                QSqlError::StatementError, DuckDBError));
+        return false;
     }
-    return ind;
+    return materializeArrowScan(view, name);
 }
 
-QSqlIndex QDuckdbDriver::primaryIndex(const QString &tblname) const
+bool QDuckdbDriver::registerArrowArray(const QString &name, ArrowSchema *schema, ArrowArray *array)
 {
-    if (!isOpen())
-        return QSqlIndex();
-
-    QString table = tblname;
-    if (isIdentifierEscaped(table, QSqlDriver::TableName))
-        table = stripDelimiters(table, QSqlDriver::TableName);
+    Q_D(QDuckdbDriver);
+    if (!isOpen() || isOpenError())
+        return false;
+    if (d->commitGroup) {
+        setLastError(qMakeError(tr("Unable to register Arrow data"), qGroupedTransactionError,
+                                QSqlError::TransactionError, DuckDBError));
+        return false;
+    }
 
-    QSqlQuery q(createResult());
-    q.setForwardOnly(true);
-    return qGetTableInfo(q, table, true);
+    const QByteArray view = "qt_arrow_scan_" + QByteArray::number(quintptr(array), 16);
+    duckdb_arrow_stream stream = nullptr;
+    const int res = duckdb_arrow_array_scan(*d->conn, view.constData(), reinterpret_cast<duckdb_arrow_schema>(schema),
+                                            reinterpret_cast<duckdb_arrow_array>(array), &stream);
+    bool ok = res == DuckDBSuccess;
+    if (!ok)
+        setLastError(qMakeError(tr("Unable to register Arrow data"), qArrowScanError, QSqlError::StatementError, res));
+    else
+        ok = materializeArrowScan(view, name);
+    if (stream)
+        duckdb_destroy_arrow_stream(&stream);
+    return ok;
 }
 
-QSqlRecord QDuckdbDriver::record(const QString &tbl) const
+/*
+   The file stays mapped for as long as the view scanning it is registered, so
+   no query copies its record batches: every statement starts the stream over
+   and the scan reads the buffers from the mapping again.
+*/
+bool QDuckdbDriver::registerArrowIpcFile(const QString &name, const QString &fileName)
 {
-    if (!isOpen())
-        return QSqlRecord();
+    Q_D(QDuckdbDriver);
+    if (!isOpen() || isOpenError())
+        return false;
+    if (d->commitGroup) {
+        setLastError(qMakeError(tr("Unable to register Arrow data"), qGroupedTransactionError,
+                                QSqlError::TransactionError, DuckDBError));
+        return false;
+    }
 
-    QString table = tbl;
-    if (isIdentifierEscaped(table, QSqlDriver::TableName))
-        table = stripDelimiters(table, QSqlDriver::TableName);
+    const QSharedPointer<QDuckdbDriverPrivate::ArrowIpcView> view =
+            QSharedPointer<QDuckdbDriverPrivate::ArrowIpcView>::create(fileName);
+    if (!view->file.open()) {
+        setLastError(qMakeError(tr("Unable to register Arrow data"), view->file.errorString().toUtf8().constData(),
+                                QSqlError::StatementError, DuckDBError));
+        return false;
+    }
+    view->file.exportStream(&view->stream);
+    // the view replaces one of the same name, whose file is released once it is gone
+    if (duckdb_arrow_scan(*d->conn, name.toUtf8().constData(),
+                          reinterpret_cast<duckdb_arrow_stream>(&view->stream)) == DuckDBError) {
+        setLastError(qMakeError(tr("Unable to register Arrow data"), qArrowScanError,
+                                QSqlError::StatementError, DuckDBError));
+        return false;
+    }
+    d->arrowIpcViews.insert(name, view);
+    d->temporaryLoaded = false;
+    d->gadgetColumns.clear();
+    return true;
+}
 
-    QSqlQuery q(createResult());
-    q.setForwardOnly(true);
-    return qGetTableInfo(q, table);
+/*
+   The views created by the Arrow scans reference the caller's memory and can
+   only be read once, so their rows are copied column-wise into a temporary table
+   and the view is dropped right away.
+*/
+bool QDuckdbDriver::materializeArrowScan(const QByteArray &view, const QString &name)
+{
+    Q_D(QDuckdbDriver);
+    duckdb_result result;
+    const QByteArray create = "CREATE OR REPLACE TEMP TABLE " + escapeIdentifier(name, TableName).toUtf8()
+            + " AS SELECT * FROM \"" + view + '"';
+    const int res = duckdb_query(*d->conn, create.constData(), &result);
+    if (res == DuckDBError) {
+        setLastError(qMakeError(tr("Unable to register Arrow data"), duckdb_result_error(&result),
+                                QSqlError::StatementError, res));
+    } else {
+        // the temporary table is private to this connection, the shared schema cache stays valid
+        d->temporaryLoaded = false;
+        d->gadgetColumns.clear();
+    }
+    duckdb_destroy_result(&result);
+
+    const QByteArray drop = "DROP VIEW IF EXISTS \"" + view + '"';
+    duckdb_query(*d->conn, drop.constData(), &result);
+    duckdb_destroy_result(&result);
+    return res == DuckDBSuccess;
 }
 
 QVariant QDuckdbDriver::handle() const
@@ -1018,18 +4737,13 @@ QString QDuckdbDriver::escapeIdentifier(const QString &identifier, IdentifierTyp
     return _q_escapeIdentifier(identifier, type);
 }
 
-// static void handle_sqlite_callback(void *qobj,int aoperation, char const *adbname, char const *atablename,
-//                                    sqlite3_int64 arowid)
-// {
-//     Q_UNUSED(aoperation);
-//     Q_UNUSED(adbname);
-//     QDuckdbDriver *driver = static_cast<QDuckdbDriver *>(qobj);
-//     if (driver) {
-//         QMetaObject::invokeMethod(driver, "handleNotification", Qt::QueuedConnection,
-//                                   Q_ARG(QString, QString::fromUtf8(atablename)), Q_ARG(qint64, arowid));
-//     }
-// }
-
+/*
+   Successful INSERT, UPDATE, DELETE and COPY statements, and appends, on any
+   connection to the database are collected per subscribed table. A table is
+   notified at most once per QDUCKDB_NOTIFY_INTERVAL, with the rows changed
+   since the last notification as payload; the source is SelfSource when all
+   of them were changed through this connection, OtherSource when none was.
+*/
 bool QDuckdbDriver::subscribeToNotification(const QString &name)
 {
     Q_D(QDuckdbDriver);
@@ -1038,16 +4752,21 @@ bool QDuckdbDriver::subscribeToNotification(const QString &name)
         return false;
     }
 
-    // if (d->notificationid.contains(name)) {
-    //     qWarning("Already subscribing to '%s'.", qPrintable(name));
-    //     return false;
-    // }
-
-    // //sqlite supports only one notification callback, so only the first is registered
-    // d->notificationid << name;
-    // if (d->notificationid.count() == 1)
-    //     sqlite3_update_hook(d->access, &handle_sqlite_callback, reinterpret_cast<void *> (this));
-
+    {
+        QMutexLocker locker(&d->notificationMutex);
+        if (d->notificationid.contains(name)) {
+            qWarning("Already subscribing to '%s'.", qPrintable(name));
+            return false;
+        }
+        d->notificationid << name;
+    }
+    if (d->notificationid.count() == 1) {
+        QSqlQuery catalog(createResult());
+        if (catalog.exec(QStringLiteral("SELECT current_database()")) && catalog.next())
+            d->notificationCatalog = catalog.value(0).toString();
+        d->notificationClock.start();
+        d->database->addListener(d);
+    }
     return true;
 }
 
@@ -1059,15 +4778,16 @@ bool QDuckdbDriver::unsubscribeFromNotification(const QString &name)
         return false;
     }
 
-    // if (!d->notificationid.contains(name)) {
-    //     qWarning("Not subscribed to '%s'.", qPrintable(name));
-    //     return false;
-    // }
-
-    // d->notificationid.removeAll(name);
-    // if (d->notificationid.isEmpty())
-    //     sqlite3_update_hook(d->access, NULL, NULL);
-
+    if (!d->notificationid.contains(name)) {
+        qWarning("Not subscribed to '%s'.", qPrintable(name));
+        return false;
+    }
+    if (d->notificationid.count() == 1)
+        d->database->removeListener(d);
+    QMutexLocker locker(&d->notificationMutex);
+    d->notificationid.removeAll(name);
+    d->pendingNotifications.remove(name);
+    d->lastNotified.remove(name);
     return true;
 }
 
@@ -1077,7 +4797,41 @@ QStringList QDuckdbDriver::subscribedToNotifications() const
     return d->notificationid;
 }
 
-void QDuckdbDriver::handleNotification(const QString &tableName, qint64 rowid)
+void QDuckdbDriver::emitNotifications()
+{
+    Q_D(QDuckdbDriver);
+    QVector<QPair<QString, QDuckdbDriverPrivate::PendingNotification>> due;
+    {
+        QMutexLocker locker(&d->notificationMutex);
+        d->notificationScheduled = false;
+        const qint64 now = d->notificationClock.elapsed();
+        qint64 wait = -1;
+        for (auto it = d->pendingNotifications.begin(); it != d->pendingNotifications.end();) {
+            const auto last = d->lastNotified.constFind(it.key());
+            const qint64 next = last == d->lastNotified.constEnd() ? now : last.value() + d->notificationInterval;
+            if (next <= now) {
+                due.append(qMakePair(it.key(), it.value()));
+                d->lastNotified.insert(it.key(), now);
+                it = d->pendingNotifications.erase(it);
+            } else {
+                wait = wait < 0 ? next - now : qMin(wait, next - now);
+                ++it;
+            }
+        }
+        // the tables notified too recently are coalesced into a later notification
+        if (wait >= 0) {
+            d->notificationScheduled = true;
+            QTimer::singleShot(int(wait), this, &QDuckdbDriver::emitNotifications);
+        }
+    }
+    for (const auto &notification : qAsConst(due)) {
+        const NotificationSource source = !notification.second.other ? SelfSource
+                : !notification.second.self ? OtherSource : UnknownSource;
+        handleNotification(notification.first, notification.second.rows, source);
+    }
+}
+
+void QDuckdbDriver::handleNotification(const QString &tableName, qint64 rows, NotificationSource source)
 {
     Q_D(const QDuckdbDriver);
     if (d->notificationid.contains(tableName)) {
@@ -1087,7 +4841,7 @@ void QDuckdbDriver::handleNotification(const QString &tableName, qint64 rowid)
             emit notification(tableName);
         QT_WARNING_POP
 #endif
-            emit notification(tableName, QSqlDriver::UnknownSource, QVariant(rowid));
+            emit notification(tableName, source, QVariant(rows));
     }
 }
 
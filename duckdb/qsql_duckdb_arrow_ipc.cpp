@@ -0,0 +1,1121 @@
+#include "qsql_duckdb_arrow_ipc_p.h"
+
+#include <qendian.h>
+#include <qiodevice.h>
+
+#include <algorithm>
+#include <cstring>
+
+QT_BEGIN_NAMESPACE
+
+// Arrow IPC encapsulates every message as FlatBuffers metadata followed by a
+// body holding the array buffers, see
+// https://arrow.apache.org/docs/format/Columnar.html#serialization-and-interprocess-communication-ipc
+// The tables and union tags below come from Schema.fbs, Message.fbs and File.fbs.
+
+enum QArrowType : quint8 {
+    ArrowNull = 1,
+    ArrowInt = 2,
+    ArrowFloatingPoint = 3,
+    ArrowBinary = 4,
+    ArrowUtf8 = 5,
+    ArrowBool = 6,
+    ArrowDecimal = 7,
+    ArrowDate = 8,
+    ArrowTime = 9,
+    ArrowTimestamp = 10,
+    ArrowInterval = 11,
+    ArrowList = 12,
+    ArrowStruct = 13,
+    ArrowFixedSizeBinary = 15,
+    ArrowMap = 17,
+    ArrowLargeBinary = 19,
+    ArrowLargeUtf8 = 20,
+    ArrowLargeList = 21
+};
+
+enum QArrowMessageHeader : quint8 {
+    ArrowSchemaMessage = 1,
+    ArrowRecordBatchMessage = 3
+};
+
+static const qint16 qArrowMetadataVersion = 4; // V5
+static const char qArrowMagic[] = "ARROW1";
+// deepest field nesting read from a file, the readers recurse once per level
+static const int qArrowMaxNesting = 64;
+
+bool QDuckdbArrowFormat::parse(const QByteArray &format, QDuckdbArrowFormat *out)
+{
+    QDuckdbArrowFormat f;
+    static const char units[] = "smun";
+
+    if (format.size() == 1) {
+        const char c = format.at(0);
+        switch (c) {
+        case 'n':
+            f.type = ArrowNull;
+            break;
+        case 'b':
+            f.type = ArrowBool;
+            f.valueWidth = -1;
+            break;
+        case 'c': case 'C': case 's': case 'S': case 'i': case 'I': case 'l': case 'L':
+            f.type = ArrowInt;
+            f.isSigned = c >= 'a';
+            f.valueWidth = c == 'c' || c == 'C' ? 1 : c == 's' || c == 'S' ? 2 : c == 'i' || c == 'I' ? 4 : 8;
+            f.bitWidth = f.valueWidth * 8;
+            break;
+        case 'e': case 'f': case 'g':
+            f.type = ArrowFloatingPoint;
+            f.unit = c - 'e';
+            f.valueWidth = 2 << f.unit;
+            break;
+        case 'z': case 'u':
+            f.type = c == 'z' ? ArrowBinary : ArrowUtf8;
+            f.offsetWidth = 4;
+            f.hasValueData = true;
+            break;
+        case 'Z': case 'U':
+            f.type = c == 'Z' ? ArrowLargeBinary : ArrowLargeUtf8;
+            f.offsetWidth = 8;
+            f.hasValueData = true;
+            break;
+        default:
+            return false;
+        }
+    } else if (format == "+l" || format == "+L" || format == "+m") {
+        f.type = format == "+l" ? ArrowList : format == "+L" ? ArrowLargeList : ArrowMap;
+        f.offsetWidth = format == "+L" ? 8 : 4;
+    } else if (format == "+s") {
+        f.type = ArrowStruct;
+    } else if (format.startsWith("w:")) {
+        bool ok = false;
+        f.type = ArrowFixedSizeBinary;
+        f.bitWidth = f.valueWidth = format.mid(2).toInt(&ok);
+        if (!ok || f.valueWidth <= 0)
+            return false;
+    } else if (format.startsWith("d:")) {
+        const QList<QByteArray> parts = format.mid(2).split(',');
+        if (parts.size() < 2)
+            return false;
+        f.type = ArrowDecimal;
+        f.precision = parts.at(0).toInt();
+        f.scale = parts.at(1).toInt();
+        f.bitWidth = parts.size() > 2 ? parts.at(2).toInt() : 128;
+        f.valueWidth = f.bitWidth / 8;
+        if (f.valueWidth <= 0)
+            return false;
+    } else if (format == "tdD" || format == "tdm") {
+        f.type = ArrowDate;
+        f.unit = format == "tdD" ? 0 : 1;
+        f.valueWidth = format == "tdD" ? 4 : 8;
+    } else if (format.size() == 3 && format.startsWith("tt") && qstrchr(units, format.at(2))) {
+        f.type = ArrowTime;
+        f.unit = qstrchr(units, format.at(2)) - units;
+        f.bitWidth = f.unit < 2 ? 32 : 64;
+        f.valueWidth = f.bitWidth / 8;
+    } else if (format.size() >= 4 && format.startsWith("ts") && qstrchr(units, format.at(2))
+               && format.at(3) == ':') {
+        f.type = ArrowTimestamp;
+        f.unit = qstrchr(units, format.at(2)) - units;
+        f.timezone = format.mid(4);
+        f.valueWidth = 8;
+    } else if (format == "tiM" || format == "tiD" || format == "tin") {
+        f.type = ArrowInterval;
+        f.unit = format == "tiM" ? 0 : format == "tiD" ? 1 : 2;
+        f.valueWidth = format == "tiM" ? 4 : format == "tiD" ? 8 : 16;
+    } else {
+        return false;
+    }
+    *out = f;
+    return true;
+}
+
+static QByteArray qArrowFormatString(const QDuckdbArrowFormat &f)
+{
+    static const char units[] = "smun";
+    switch (f.type) {
+    case ArrowNull:
+        return "n";
+    case ArrowBool:
+        return "b";
+    case ArrowInt: {
+        const char c = f.bitWidth == 8 ? 'c' : f.bitWidth == 16 ? 's' : f.bitWidth == 32 ? 'i' : 'l';
+        return QByteArray(1, f.isSigned ? c : char(c - 'a' + 'A'));
+    }
+    case ArrowFloatingPoint:
+        return QByteArray(1, char('e' + f.unit));
+    case ArrowBinary:
+        return "z";
+    case ArrowUtf8:
+        return "u";
+    case ArrowLargeBinary:
+        return "Z";
+    case ArrowLargeUtf8:
+        return "U";
+    case ArrowList:
+        return "+l";
+    case ArrowLargeList:
+        return "+L";
+    case ArrowMap:
+        return "+m";
+    case ArrowStruct:
+        return "+s";
+    case ArrowFixedSizeBinary:
+        return "w:" + QByteArray::number(f.bitWidth);
+    case ArrowDecimal:
+        return "d:" + QByteArray::number(f.precision) + ',' + QByteArray::number(f.scale)
+                + (f.bitWidth != 128 ? ',' + QByteArray::number(f.bitWidth) : QByteArray());
+    case ArrowDate:
+        return f.unit == 0 ? "tdD" : "tdm";
+    case ArrowTime:
+        return "tt" + QByteArray(1, units[f.unit & 3]);
+    case ArrowTimestamp:
+        return "ts" + QByteArray(1, units[f.unit & 3]) + ':' + f.timezone;
+    case ArrowInterval:
+        return f.unit == 0 ? "tiM" : f.unit == 1 ? "tiD" : "tin";
+    }
+    return QByteArray();
+}
+
+static void qPad(QByteArray *data, int alignment)
+{
+    while (data->size() % alignment)
+        data->append('\0');
+}
+
+template <typename T>
+static void qAppendScalar(QByteArray *data, T value)
+{
+    char bytes[sizeof(T)];
+    qToLittleEndian(value, bytes);
+    data->append(bytes, sizeof(T));
+}
+
+/*
+   Minimal FlatBuffers builder. Objects are laid out parent first, each table
+   preceded by its vtable, and the forward uoffset_t references are patched
+   once the referenced object has been placed.
+*/
+class QDuckdbFlatBufferBuilder
+{
+public:
+    int table() { return addObject(Table); }
+
+    template <typename T>
+    void add(int table, int id, T value)
+    {
+        Field field;
+        field.id = id;
+        qAppendScalar(&field.scalar, value);
+        objects[table].fields.append(field);
+    }
+
+    void addObject(int table, int id, int object)
+    {
+        Field field;
+        field.id = id;
+        field.object = object;
+        objects[table].fields.append(field);
+    }
+
+    int string(const QByteArray &value)
+    {
+        const int object = addObject(String);
+        objects[object].bytes = value;
+        return object;
+    }
+
+    int vector(const QVector<int> &elements)
+    {
+        const int object = addObject(Vector);
+        objects[object].elements = elements;
+        return object;
+    }
+
+    // a vector of structs aligned to 8 bytes, such as FieldNode, Buffer and Block
+    int structVector(const QByteArray &elements, int count)
+    {
+        const int object = addObject(StructVector);
+        objects[object].bytes = elements;
+        objects[object].count = count;
+        return object;
+    }
+
+    QByteArray finish(int root)
+    {
+        buffer.clear();
+        buffer.append(4, '\0');
+        patch(0, place(root));
+        qPad(&buffer, 8);
+        return buffer;
+    }
+
+private:
+    enum Kind { Table, Vector, StructVector, String };
+    struct Field
+    {
+        int id = 0;
+        QByteArray scalar;
+        int object = -1;
+        int size() const { return object < 0 ? scalar.size() : 4; }
+    };
+    struct Object
+    {
+        Kind kind;
+        QVector<Field> fields;
+        QVector<int> elements;
+        QByteArray bytes;
+        int count = 0;
+    };
+
+    int addObject(Kind kind)
+    {
+        Object object;
+        object.kind = kind;
+        objects.push_back(object);
+        return int(objects.size()) - 1;
+    }
+
+    void patch(int position, int target)
+    {
+        qToLittleEndian<quint32>(quint32(target - position), buffer.data() + position);
+    }
+
+    int place(int index)
+    {
+        const Object &object = objects[index];
+        QVector<QPair<int, int>> references;
+        int position = 0;
+
+        switch (object.kind) {
+        case Table: {
+            int fieldCount = 0;
+            for (const Field &field : object.fields)
+                fieldCount = qMax(fieldCount, field.id + 1);
+            QVector<Field> fields = object.fields;
+            std::stable_sort(fields.begin(), fields.end(), [](const Field &a, const Field &b) {
+                return a.size() > b.size();
+            });
+
+            qPad(&buffer, 2);
+            const int vtable = buffer.size();
+            buffer.append(4 + 2 * fieldCount, '\0');
+            qPad(&buffer, 4);
+            position = buffer.size();
+            qAppendScalar<qint32>(&buffer, position - vtable);
+            QVector<quint16> offsets(fieldCount, 0);
+            for (const Field &field : qAsConst(fields)) {
+                qPad(&buffer, field.size());
+                offsets[field.id] = quint16(buffer.size() - position);
+                if (field.object < 0) {
+                    buffer.append(field.scalar);
+                } else {
+                    references.append(qMakePair(buffer.size(), field.object));
+                    buffer.append(4, '\0');
+                }
+            }
+            qToLittleEndian<quint16>(quint16(4 + 2 * fieldCount), buffer.data() + vtable);
+            qToLittleEndian<quint16>(quint16(buffer.size() - position), buffer.data() + vtable + 2);
+            for (int i = 0; i < fieldCount; ++i)
+                qToLittleEndian<quint16>(offsets.at(i), buffer.data() + vtable + 4 + 2 * i);
+            break;
+        }
+        case Vector:
+            qPad(&buffer, 4);
+            position = buffer.size();
+            qAppendScalar<quint32>(&buffer, quint32(object.elements.size()));
+            for (int element : object.elements) {
+                references.append(qMakePair(buffer.size(), element));
+                buffer.append(4, '\0');
+            }
+            break;
+        case StructVector:
+            while ((buffer.size() + 4) % 8)
+                buffer.append('\0');
+            position = buffer.size();
+            qAppendScalar<quint32>(&buffer, quint32(object.count));
+            buffer.append(object.bytes);
+            break;
+        case String:
+            qPad(&buffer, 4);
+            position = buffer.size();
+            qAppendScalar<quint32>(&buffer, quint32(object.bytes.size()));
+            buffer.append(object.bytes);
+            buffer.append('\0');
+            break;
+        }
+
+        for (const auto &reference : qAsConst(references))
+            patch(reference.first, place(reference.second));
+        return position;
+    }
+
+    std::vector<Object> objects;
+    QByteArray buffer;
+};
+
+static int qArrowTypeTable(QDuckdbFlatBufferBuilder &fb, const QDuckdbArrowFormat &f, qint64 flags)
+{
+    const int type = fb.table();
+    switch (f.type) {
+    case ArrowInt:
+        fb.add<qint32>(type, 0, f.bitWidth);
+        fb.add<quint8>(type, 1, f.isSigned);
+        break;
+    case ArrowFloatingPoint:
+    case ArrowDate:
+    case ArrowInterval:
+        fb.add<qint16>(type, 0, f.unit);
+        break;
+    case ArrowDecimal:
+        fb.add<qint32>(type, 0, f.precision);
+        fb.add<qint32>(type, 1, f.scale);
+        fb.add<qint32>(type, 2, f.bitWidth);
+        break;
+    case ArrowTime:
+        fb.add<qint16>(type, 0, f.unit);
+        fb.add<qint32>(type, 1, f.bitWidth);
+        break;
+    case ArrowTimestamp:
+        fb.add<qint16>(type, 0, f.unit);
+        if (!f.timezone.isEmpty())
+            fb.addObject(type, 1, fb.string(f.timezone));
+        break;
+    case ArrowFixedSizeBinary:
+        fb.add<qint32>(type, 0, f.bitWidth);
+        break;
+    case ArrowMap:
+        fb.add<quint8>(type, 0, (flags & ARROW_FLAG_MAP_KEYS_SORTED) != 0);
+        break;
+    default:
+        break;
+    }
+    return type;
+}
+
+static int qArrowFieldTable(QDuckdbFlatBufferBuilder &fb, const QDuckdbArrowField &field)
+{
+    QVector<int> children;
+    for (const QDuckdbArrowField &child : field.children)
+        children.append(qArrowFieldTable(fb, child));
+
+    const int table = fb.table();
+    fb.addObject(table, 0, fb.string(field.name));
+    fb.add<quint8>(table, 1, (field.flags & ARROW_FLAG_NULLABLE) != 0);
+    fb.add<quint8>(table, 2, field.format.type);
+    fb.addObject(table, 3, qArrowTypeTable(fb, field.format, field.flags));
+    fb.addObject(table, 5, fb.vector(children));
+    return table;
+}
+
+static int qArrowSchemaTable(QDuckdbFlatBufferBuilder &fb, const QDuckdbArrowField &schema)
+{
+    QVector<int> fields;
+    for (const QDuckdbArrowField &field : schema.children)
+        fields.append(qArrowFieldTable(fb, field));
+
+    const int table = fb.table();
+    fb.add<qint16>(table, 0, 0); // little endian
+    fb.addObject(table, 1, fb.vector(fields));
+    return table;
+}
+
+static int qArrowMessageTable(QDuckdbFlatBufferBuilder &fb, quint8 headerType, int header, qint64 bodyLength)
+{
+    const int message = fb.table();
+    fb.add<qint16>(message, 0, qArrowMetadataVersion);
+    fb.add<quint8>(message, 1, headerType);
+    fb.addObject(message, 2, header);
+    fb.add<qint64>(message, 3, bodyLength);
+    return message;
+}
+
+QDuckdbArrowIpcWriter::QDuckdbArrowIpcWriter(QIODevice *device, bool fileFormat)
+    : device(device), fileFormat(fileFormat)
+{
+}
+
+bool QDuckdbArrowIpcWriter::readField(const ArrowSchema *schema, QDuckdbArrowField *field)
+{
+    if (schema->dictionary) {
+        error = QStringLiteral("Dictionary encoded Arrow columns are not supported");
+        return false;
+    }
+    if (!QDuckdbArrowFormat::parse(schema->format, &field->format)) {
+        error = QStringLiteral("Unsupported Arrow format %1").arg(QString::fromUtf8(schema->format));
+        return false;
+    }
+    field->name = schema->name;
+    field->flags = schema->flags;
+    field->children.resize(schema->n_children);
+    for (qint64 i = 0; i < schema->n_children; ++i) {
+        if (!readField(schema->children[i], &field->children[i]))
+            return false;
+    }
+    return true;
+}
+
+bool QDuckdbArrowIpcWriter::write(const QByteArray &data)
+{
+    if (device->write(data) != data.size()) {
+        error = device->errorString();
+        return false;
+    }
+    position += data.size();
+    return true;
+}
+
+bool QDuckdbArrowIpcWriter::writeMessage(const QByteArray &metadata, const QByteArray &body, Block *block)
+{
+    block->offset = position;
+    block->metaDataLength = 8 + metadata.size();
+    block->bodyLength = body.size();
+
+    QByteArray prefix;
+    qAppendScalar<qint32>(&prefix, -1);
+    qAppendScalar<qint32>(&prefix, metadata.size());
+    return write(prefix) && write(metadata) && write(body);
+}
+
+bool QDuckdbArrowIpcWriter::writeSchema(const ArrowSchema *arrowSchema)
+{
+    if (!readField(arrowSchema, &schema))
+        return false;
+    if (schema.format.type != ArrowStruct) {
+        error = QStringLiteral("The Arrow schema is not a struct");
+        return false;
+    }
+
+    if (fileFormat && !write(QByteArray(qArrowMagic, 6) + QByteArray(2, '\0')))
+        return false;
+
+    QDuckdbFlatBufferBuilder fb;
+    const int message = qArrowMessageTable(fb, ArrowSchemaMessage, qArrowSchemaTable(fb, schema), 0);
+    Block block;
+    return writeMessage(fb.finish(message), QByteArray(), &block);
+}
+
+static void qAppendBuffer(QByteArray *buffers, QByteArray *body, const void *data, qint64 length)
+{
+    qAppendScalar<qint64>(buffers, body->size());
+    qAppendScalar<qint64>(buffers, length);
+    if (data)
+        body->append(static_cast<const char *>(data), int(length));
+    else
+        body->append(int(length), '\0');
+    qPad(body, 8);
+}
+
+bool QDuckdbArrowIpcWriter::appendArray(const QDuckdbArrowField &field, const ArrowArray *array,
+                                        QByteArray *nodes, QByteArray *buffers, QByteArray *body)
+{
+    if (array->offset != 0) {
+        error = QStringLiteral("Sliced Arrow arrays are not supported");
+        return false;
+    }
+    if (qint64(field.children.size()) != array->n_children) {
+        error = QStringLiteral("The Arrow array does not match its schema");
+        return false;
+    }
+
+    const QDuckdbArrowFormat &f = field.format;
+    const qint64 length = array->length;
+    if (f.type == ArrowNull) {
+        qAppendScalar<qint64>(nodes, length);
+        qAppendScalar<qint64>(nodes, length);
+        return true;
+    }
+
+    const uchar *validity = static_cast<const uchar *>(array->buffers[0]);
+    qint64 nullCount = validity ? array->null_count : 0;
+    if (nullCount < 0) {
+        nullCount = 0;
+        for (qint64 i = 0; i < length; ++i)
+            nullCount += !(validity[i >> 3] & (1 << (i & 7)));
+    }
+    qAppendScalar<qint64>(nodes, length);
+    qAppendScalar<qint64>(nodes, nullCount);
+    qAppendBuffer(buffers, body, nullCount ? validity : nullptr, nullCount ? (length + 7) / 8 : 0);
+
+    qint64 childLength = length;
+    if (f.offsetWidth) {
+        const char *offsets = static_cast<const char *>(array->buffers[1]);
+        qAppendBuffer(buffers, body, offsets, (length + 1) * f.offsetWidth);
+        qint64 end = 0;
+        if (offsets && length) {
+            end = f.offsetWidth == 4 ? qFromLittleEndian<qint32>(offsets + 4 * length)
+                                     : qFromLittleEndian<qint64>(offsets + 8 * length);
+        }
+        if (f.hasValueData)
+            qAppendBuffer(buffers, body, array->buffers[2], end);
+        else
+            childLength = end;
+    } else if (f.valueWidth) {
+        qAppendBuffer(buffers, body, array->buffers[1],
+                      f.valueWidth < 0 ? (length + 7) / 8 : length * f.valueWidth);
+    }
+
+    for (qint64 i = 0; i < array->n_children; ++i) {
+        if (f.type != ArrowStruct && array->children[i]->length != childLength) {
+            error = QStringLiteral("The Arrow list child has an unexpected length");
+            return false;
+        }
+        if (!appendArray(field.children[i], array->children[i], nodes, buffers, body))
+            return false;
+    }
+    return true;
+}
+
+bool QDuckdbArrowIpcWriter::writeBatch(const ArrowArray *array)
+{
+    if (qint64(schema.children.size()) != array->n_children) {
+        error = QStringLiteral("The Arrow array does not match its schema");
+        return false;
+    }
+
+    // the top level struct is implicit, its children are the record batch columns
+    QByteArray nodes;
+    QByteArray buffers;
+    QByteArray body;
+    for (qint64 i = 0; i < array->n_children; ++i) {
+        if (!appendArray(schema.children[i], array->children[i], &nodes, &buffers, &body))
+            return false;
+    }
+
+    QDuckdbFlatBufferBuilder fb;
+    const int batch = fb.table();
+    fb.add<qint64>(batch, 0, array->length);
+    fb.addObject(batch, 1, fb.structVector(nodes, nodes.size() / 16));
+    fb.addObject(batch, 2, fb.structVector(buffers, buffers.size() / 16));
+    const int message = qArrowMessageTable(fb, ArrowRecordBatchMessage, batch, body.size());
+
+    Block block;
+    if (!writeMessage(fb.finish(message), body, &block))
+        return false;
+    batches.append(block);
+    return true;
+}
+
+bool QDuckdbArrowIpcWriter::finish()
+{
+    QByteArray endOfStream;
+    qAppendScalar<qint32>(&endOfStream, -1);
+    qAppendScalar<qint32>(&endOfStream, 0);
+    if (!write(endOfStream))
+        return false;
+    if (!fileFormat)
+        return true;
+
+    QByteArray blocks;
+    for (const Block &block : qAsConst(batches)) {
+        qAppendScalar<qint64>(&blocks, block.offset);
+        qAppendScalar<qint32>(&blocks, block.metaDataLength);
+        qAppendScalar<qint32>(&blocks, 0);
+        qAppendScalar<qint64>(&blocks, block.bodyLength);
+    }
+    QDuckdbFlatBufferBuilder fb;
+    const int footer = fb.table();
+    fb.add<qint16>(footer, 0, qArrowMetadataVersion);
+    fb.addObject(footer, 1, qArrowSchemaTable(fb, schema));
+    fb.addObject(footer, 2, fb.structVector(QByteArray(), 0));
+    fb.addObject(footer, 3, fb.structVector(blocks, batches.size()));
+    const QByteArray metadata = fb.finish(footer);
+
+    QByteArray trailer;
+    qAppendScalar<qint32>(&trailer, metadata.size());
+    trailer.append(qArrowMagic, 6);
+    return write(metadata) && write(trailer);
+}
+
+/*
+   Read access to a FlatBuffers table, every read is bounds checked against
+   the mapped file and yields the default value when it is out of range.
+*/
+class QDuckdbArrowIpcFile::Table
+{
+public:
+    Table() = default;
+    Table(const uchar *base, qint64 size, qint64 position)
+        : base(base), size(size), position(position)
+    {
+        qint32 offset = 0;
+        if (!read(position, &offset))
+            this->base = nullptr;
+        else
+            vtable = position - offset;
+    }
+
+    static Table root(const uchar *base, qint64 size)
+    {
+        quint32 offset = 0;
+        if (!readAt(base, size, 0, &offset))
+            return Table();
+        return Table(base, size, offset);
+    }
+
+    bool isValid() const { return base; }
+
+    template <typename T>
+    T scalar(int id, T defaultValue) const
+    {
+        T value = defaultValue;
+        const qint64 at = field(id);
+        if (at)
+            read(at, &value);
+        return value;
+    }
+
+    bool has(int id) const { return field(id); }
+
+    Table table(int id) const
+    {
+        const qint64 at = field(id);
+        quint32 offset = 0;
+        if (!at || !read(at, &offset))
+            return Table();
+        return Table(base, size, at + offset);
+    }
+
+    QByteArray string(int id) const
+    {
+        qint64 length = 0;
+        const qint64 at = vector(id, &length);
+        if (!at || at + length > size)
+            return QByteArray();
+        return QByteArray(reinterpret_cast<const char *>(base + at), int(length));
+    }
+
+    // position of the first element of a vector field
+    qint64 vector(int id, qint64 *count) const
+    {
+        const qint64 at = field(id);
+        quint32 offset = 0;
+        quint32 length = 0;
+        *count = 0;
+        if (!at || !read(at, &offset) || !read(at + offset, &length))
+            return 0;
+        *count = length;
+        return at + offset + 4;
+    }
+
+    Table vectorTable(qint64 elements, qint64 index) const
+    {
+        const qint64 at = elements + 4 * index;
+        quint32 offset = 0;
+        if (!read(at, &offset))
+            return Table();
+        return Table(base, size, at + offset);
+    }
+
+    template <typename T>
+    bool read(qint64 at, T *value) const { return readAt(base, size, at, value); }
+
+    template <typename T>
+    static bool readAt(const uchar *base, qint64 size, qint64 at, T *value)
+    {
+        if (!base || at < 0 || at + qint64(sizeof(T)) > size)
+            return false;
+        *value = qFromLittleEndian<T>(base + at);
+        return true;
+    }
+
+    qint64 field(int id) const
+    {
+        quint16 vtableSize = 0;
+        quint16 offset = 0;
+        if (!base || !read(vtable, &vtableSize) || 4 + 2 * id >= vtableSize
+                || !read(vtable + 4 + 2 * id, &offset) || !offset)
+            return 0;
+        return position + offset;
+    }
+
+    const uchar *base = nullptr;
+    qint64 size = 0;
+    qint64 position = 0;
+    qint64 vtable = 0;
+};
+
+QDuckdbArrowIpcFile::QDuckdbArrowIpcFile(const QString &fileName)
+    : file(fileName)
+{
+}
+
+bool QDuckdbArrowIpcFile::readMessage(qint64 offset, Table *message, qint64 *bodyStart, qint64 *next)
+{
+    qint32 length = 0;
+    if (!Table::readAt(data, size, offset, &length))
+        return false;
+    offset += 4;
+    // messages written before 0.15 have no continuation marker
+    if (length == -1) {
+        if (!Table::readAt(data, size, offset, &length))
+            return false;
+        offset += 4;
+    }
+    if (length <= 0 || offset + length > size)
+        return false;
+
+    *message = Table::root(data + offset, length);
+    *bodyStart = offset + length;
+    *next = *bodyStart + message->scalar<qint64>(3, 0);
+    return message->isValid();
+}
+
+QDuckdbArrowIpcFile::SchemaNode *QDuckdbArrowIpcFile::readField(const Table &field, int depth)
+{
+    if (depth > qArrowMaxNesting) {
+        error = QStringLiteral("The Arrow schema is nested too deeply");
+        return nullptr;
+    }
+    if (field.has(4)) {
+        error = QStringLiteral("Dictionary encoded Arrow columns are not supported");
+        return nullptr;
+    }
+
+    QDuckdbArrowFormat f;
+    const Table type = field.table(3);
+    f.type = field.scalar<quint8>(2, 0);
+    switch (f.type) {
+    case ArrowInt:
+        f.bitWidth = type.scalar<qint32>(0, 0);
+        f.isSigned = type.scalar<quint8>(1, 0);
+        break;
+    case ArrowFloatingPoint:
+    case ArrowInterval:
+        f.unit = type.scalar<qint16>(0, 0);
+        break;
+    case ArrowDate:
+    case ArrowTime:
+        f.unit = type.scalar<qint16>(0, 1);
+        f.bitWidth = type.scalar<qint32>(1, 32);
+        break;
+    case ArrowTimestamp:
+        f.unit = type.scalar<qint16>(0, 0);
+        f.timezone = type.string(1);
+        break;
+    case ArrowDecimal:
+        f.precision = type.scalar<qint32>(0, 0);
+        f.scale = type.scalar<qint32>(1, 0);
+        f.bitWidth = type.scalar<qint32>(2, 128);
+        break;
+    case ArrowFixedSizeBinary:
+        f.bitWidth = type.scalar<qint32>(0, 0);
+        break;
+    default:
+        break;
+    }
+
+    schemaNodes.emplace_back();
+    SchemaNode *node = &schemaNodes.back();
+    node->format = qArrowFormatString(f);
+    node->name = field.string(0);
+    if (!QDuckdbArrowFormat::parse(node->format, &node->parsed)) {
+        error = QStringLiteral("Unsupported Arrow type %1").arg(f.type);
+        return nullptr;
+    }
+
+    qint64 count = 0;
+    const qint64 children = field.vector(5, &count);
+    for (qint64 i = 0; i < count; ++i) {
+        SchemaNode *child = readField(field.vectorTable(children, i), depth + 1);
+        if (!child)
+            return nullptr;
+        node->fields.push_back(child);
+        node->children.push_back(&child->schema);
+    }
+
+    node->schema = ArrowSchema();
+    node->schema.format = node->format.constData();
+    node->schema.name = node->name.constData();
+    node->schema.flags = (field.scalar<quint8>(1, 0) ? ARROW_FLAG_NULLABLE : 0)
+            | (f.type == ArrowMap && type.scalar<quint8>(0, 0) ? ARROW_FLAG_MAP_KEYS_SORTED : 0);
+    node->schema.n_children = qint64(node->children.size());
+    node->schema.children = node->children.data();
+    node->schema.release = [](ArrowSchema *schema) { schema->release = nullptr; };
+    return node;
+}
+
+QDuckdbArrowIpcFile::SchemaNode *QDuckdbArrowIpcFile::readSchema(const Table &schema)
+{
+    schemaNodes.emplace_back();
+    SchemaNode *node = &schemaNodes.back();
+    node->format = "+s";
+    QDuckdbArrowFormat::parse(node->format, &node->parsed);
+
+    qint64 count = 0;
+    const qint64 fields = schema.vector(1, &count);
+    for (qint64 i = 0; i < count; ++i) {
+        SchemaNode *field = readField(schema.vectorTable(fields, i), 1);
+        if (!field)
+            return nullptr;
+        node->fields.push_back(field);
+        node->children.push_back(&field->schema);
+    }
+
+    node->schema = ArrowSchema();
+    node->schema.format = node->format.constData();
+    node->schema.name = "";
+    node->schema.n_children = qint64(node->children.size());
+    node->schema.children = node->children.data();
+    node->schema.release = [](ArrowSchema *schema) { schema->release = nullptr; };
+    return node;
+}
+
+// the offsets of a binary or list array ascend from 0 up to limit at most
+static bool qValidOffsets(const uchar *offsets, int width, qint64 length, qint64 limit)
+{
+    qint64 previous = 0;
+    for (qint64 i = 0; i <= length; ++i) {
+        const qint64 offset = width == 8 ? qFromLittleEndian<qint64>(offsets + 8 * i)
+                                         : qint64(qFromLittleEndian<qint32>(offsets + 4 * i));
+        if (offset < previous || offset > limit)
+            return false;
+        previous = offset;
+    }
+    return true;
+}
+
+/*
+   The buffers handed to DuckDB are read without further checks, so every
+   buffer must lie within the record batch body and be large enough for the
+   length of its node, and offsets must stay within the values they index.
+   The nesting of the arrays is bounded by the one of the schema.
+*/
+ArrowArray *QDuckdbArrowIpcFile::readArray(const SchemaNode *field, const Table &batch, qint64 bodyStart,
+                                           qint64 *node, qint64 *buffer)
+{
+    qint64 nodeCount = 0;
+    qint64 bufferCount = 0;
+    const qint64 nodes = batch.vector(1, &nodeCount);
+    const qint64 buffers = batch.vector(2, &bufferCount);
+    if (*node >= nodeCount) {
+        error = QStringLiteral("The Arrow record batch has too few field nodes");
+        return nullptr;
+    }
+
+    arrayNodes.emplace_back();
+    ArrayNode *array = &arrayNodes.back();
+    array->array = ArrowArray();
+    batch.read(nodes + 16 * *node, &array->array.length);
+    batch.read(nodes + 16 * *node + 8, &array->array.null_count);
+    ++*node;
+    const qint64 length = array->array.length;
+    if (length < 0 || length > 8 * size || array->array.null_count < 0 || array->array.null_count > length) {
+        error = QStringLiteral("The Arrow record batch has an invalid field node");
+        return nullptr;
+    }
+
+    const QDuckdbArrowFormat &f = field->parsed;
+    const int count = f.type == ArrowNull ? 0 : 1 + (f.offsetWidth ? 1 : 0) + (f.hasValueData || f.valueWidth ? 1 : 0);
+    qint64 valueLength = 0;
+    for (int i = 0; i < count; ++i, ++*buffer) {
+        qint64 offset = 0;
+        qint64 bufferLength = 0;
+        if (*buffer >= bufferCount || !batch.read(buffers + 16 * *buffer, &offset)
+                || !batch.read(buffers + 16 * *buffer + 8, &bufferLength)
+                || offset < 0 || bufferLength < 0 || offset > size - bodyStart
+                || bufferLength > size - bodyStart - offset) {
+            error = QStringLiteral("The Arrow record batch buffers are out of range");
+            return nullptr;
+        }
+
+        qint64 required = 0;
+        if (i == 0)
+            required = array->array.null_count ? (length + 7) / 8 : 0;
+        else if (i == 1 && f.offsetWidth)
+            required = length ? (length + 1) * f.offsetWidth : 0;
+        else if (f.valueWidth > 0)
+            required = length * f.valueWidth;
+        else if (f.valueWidth < 0)
+            required = (length + 7) / 8;
+        else
+            valueLength = bufferLength;
+        if (bufferLength < required) {
+            error = QStringLiteral("The Arrow record batch buffers are too short");
+            return nullptr;
+        }
+        // no validity bitmap is needed when there are no nulls
+        const bool omit = i == 0 && (bufferLength == 0 || array->array.null_count == 0);
+        array->buffers.push_back(omit ? nullptr : data + bodyStart + offset);
+    }
+
+    for (const SchemaNode *child : field->fields) {
+        ArrowArray *childArray = readArray(child, batch, bodyStart, node, buffer);
+        if (!childArray)
+            return nullptr;
+        // struct children hold a value for every row
+        if (f.type == ArrowStruct && childArray->length < length) {
+            error = QStringLiteral("The Arrow record batch has a short struct field");
+            return nullptr;
+        }
+        array->children.push_back(childArray);
+    }
+
+    if (f.offsetWidth && length) {
+        const qint64 limit = f.hasValueData ? valueLength
+                                            : array->children.empty() ? 0 : array->children.front()->length;
+        if (!qValidOffsets(static_cast<const uchar *>(array->buffers.at(1)), f.offsetWidth, length, limit)) {
+            error = QStringLiteral("The Arrow record batch has invalid offsets");
+            return nullptr;
+        }
+    }
+
+    array->array.n_buffers = qint64(array->buffers.size());
+    array->array.buffers = array->buffers.data();
+    array->array.n_children = qint64(array->children.size());
+    array->array.children = array->children.data();
+    array->array.release = [](ArrowArray *array) { array->release = nullptr; };
+    return &array->array;
+}
+
+bool QDuckdbArrowIpcFile::readBatch(const Table &message, qint64 bodyStart)
+{
+    if (message.scalar<quint8>(1, 0) != ArrowRecordBatchMessage) {
+        error = QStringLiteral("Only record batch messages are supported");
+        return false;
+    }
+    const Table batch = message.table(2);
+    if (!batch.isValid() || batch.has(3)) {
+        error = QStringLiteral("Compressed Arrow record batches are not supported");
+        return false;
+    }
+
+    arrayNodes.emplace_back();
+    ArrayNode *top = &arrayNodes.back();
+    top->buffers.push_back(nullptr);
+    qint64 node = 0;
+    qint64 buffer = 0;
+    const qint64 length = batch.scalar<qint64>(0, 0);
+    for (const SchemaNode *field : root->fields) {
+        ArrowArray *child = readArray(field, batch, bodyStart, &node, &buffer);
+        if (!child)
+            return false;
+        if (child->length < length) {
+            error = QStringLiteral("The Arrow record batch has a short column");
+            return false;
+        }
+        top->children.push_back(child);
+    }
+
+    top->array = ArrowArray();
+    top->array.length = length;
+    top->array.n_buffers = 1;
+    top->array.buffers = top->buffers.data();
+    top->array.n_children = qint64(top->children.size());
+    top->array.children = top->children.data();
+    top->array.release = [](ArrowArray *array) { array->release = nullptr; };
+    batches.append(&top->array);
+    return true;
+}
+
+bool QDuckdbArrowIpcFile::open()
+{
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = file.errorString();
+        return false;
+    }
+    size = file.size();
+    data = file.map(0, size);
+    if (!data) {
+        error = file.errorString();
+        return false;
+    }
+
+    Table message;
+    qint64 bodyStart = 0;
+    qint64 next = 0;
+    if (size >= 18 && memcmp(data, qArrowMagic, 6) == 0 && memcmp(data + size - 6, qArrowMagic, 6) == 0) {
+        // file format, the footer indexes the record batches
+        qint32 footerLength = 0;
+        Table::readAt(data, size, size - 10, &footerLength);
+        if (footerLength <= 0 || footerLength > size - 18) {
+            error = QStringLiteral("Invalid Arrow file footer");
+            return false;
+        }
+        const Table footer = Table::root(data + size - 10 - footerLength, footerLength);
+        root = readSchema(footer.table(1));
+        if (!root)
+            return false;
+
+        qint64 count = 0;
+        const qint64 blocks = footer.vector(3, &count);
+        for (qint64 i = 0; i < count; ++i) {
+            qint64 offset = 0;
+            if (!footer.read(blocks + 24 * i, &offset) || !readMessage(offset, &message, &bodyStart, &next)) {
+                error = QStringLiteral("Invalid Arrow record batch block");
+                return false;
+            }
+            if (!readBatch(message, bodyStart))
+                return false;
+        }
+        return true;
+    }
+
+    // streaming format, a schema message followed by record batches up to the end marker
+    if (!readMessage(0, &message, &bodyStart, &next) || message.scalar<quint8>(1, 0) != ArrowSchemaMessage) {
+        error = QStringLiteral("Not an Arrow IPC file");
+        return false;
+    }
+    root = readSchema(message.table(2));
+    if (!root)
+        return false;
+    while (next < size) {
+        // the end of stream marker is a zero length, after a continuation marker since 0.15
+        qint32 marker = 1;
+        Table::readAt(data, size, next, &marker);
+        if (marker == -1) {
+            marker = 1;
+            Table::readAt(data, size, next + 4, &marker);
+        }
+        if (marker == 0)
+            break;
+        if (!readMessage(next, &message, &bodyStart, &next)) {
+            error = QStringLiteral("The Arrow IPC stream is truncated");
+            return false;
+        }
+        if (!readBatch(message, bodyStart))
+            return false;
+    }
+    return true;
+}
+
+int QDuckdbArrowIpcFile::getSchema(ArrowArrayStream *stream, ArrowSchema *out)
+{
+    const QDuckdbArrowIpcFile *that = static_cast<const QDuckdbArrowIpcFile *>(stream->private_data);
+    *out = that->root->schema;
+    return 0;
+}
+
+int QDuckdbArrowIpcFile::getNext(ArrowArrayStream *stream, ArrowArray *out)
+{
+    QDuckdbArrowIpcFile *that = static_cast<QDuckdbArrowIpcFile *>(stream->private_data);
+    if (that->nextBatch >= that->batches.size()) {
+        out->release = nullptr;
+        return 0;
+    }
+    *out = *that->batches.at(that->nextBatch++);
+    return 0;
+}
+
+const char *QDuckdbArrowIpcFile::getLastError(ArrowArrayStream *)
+{
+    return nullptr;
+}
+
+void QDuckdbArrowIpcFile::release(ArrowArrayStream *stream)
+{
+    stream->release = nullptr;
+}
+
+void QDuckdbArrowIpcFile::exportStream(ArrowArrayStream *stream)
+{
+    nextBatch = 0;
+    stream->get_schema = getSchema;
+    stream->get_next = getNext;
+    stream->get_last_error = getLastError;
+    stream->release = release;
+    stream->private_data = this;
+}
+
+QT_END_NAMESPACE
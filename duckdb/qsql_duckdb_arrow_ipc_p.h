@@ -0,0 +1,149 @@
+#ifndef QSQL_DUCKDB_ARROW_IPC_P_H
+#define QSQL_DUCKDB_ARROW_IPC_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/qbytearray.h>
+#include <QtCore/qfile.h>
+#include <QtCore/qstring.h>
+#include <QtCore/qvector.h>
+
+#include "qsql_duckdb_arrow.h"
+
+#include <deque>
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+
+class QIODevice;
+
+// Type and buffer layout of an Arrow format string
+struct QDuckdbArrowFormat
+{
+    quint8 type = 0;            // flatbuffers Type union tag
+    int bitWidth = 0;           // Int, Time, Decimal, byte width of FixedSizeBinary
+    bool isSigned = false;
+    qint16 unit = 0;            // FloatingPoint precision, Date/Time/Timestamp/Interval unit
+    int precision = 0;
+    int scale = 0;
+    QByteArray timezone;
+    int offsetWidth = 0;        // 4 or 8 for binary and list types
+    int valueWidth = 0;         // bytes per value of the data buffer, -1 for bitmaps
+    bool hasValueData = false;  // binary types, the data is sized by the last offset
+
+    static bool parse(const QByteArray &format, QDuckdbArrowFormat *out);
+};
+
+struct QDuckdbArrowField
+{
+    QByteArray name;
+    QDuckdbArrowFormat format;
+    qint64 flags = 0;
+    std::vector<QDuckdbArrowField> children;
+};
+
+/*
+   Writes Arrow IPC messages to a device one record batch at a time, in the
+   streaming format or, with a footer indexing the batches, in the file format.
+*/
+class QDuckdbArrowIpcWriter
+{
+public:
+    QDuckdbArrowIpcWriter(QIODevice *device, bool fileFormat);
+
+    bool writeSchema(const ArrowSchema *schema);
+    bool writeBatch(const ArrowArray *array);
+    bool finish();
+    QString errorString() const { return error; }
+
+private:
+    struct Block
+    {
+        qint64 offset;
+        qint32 metaDataLength;
+        qint64 bodyLength;
+    };
+
+    bool readField(const ArrowSchema *schema, QDuckdbArrowField *field);
+    bool appendArray(const QDuckdbArrowField &field, const ArrowArray *array,
+                     QByteArray *nodes, QByteArray *buffers, QByteArray *body);
+    bool write(const QByteArray &data);
+    bool writeMessage(const QByteArray &metadata, const QByteArray &body, Block *block);
+
+    QIODevice *device;
+    bool fileFormat;
+    qint64 position = 0;
+    QDuckdbArrowField schema;
+    QVector<Block> batches;
+    QString error;
+};
+
+/*
+   Maps an Arrow IPC file (file or streaming format) and exposes its record
+   batches as an ArrowArrayStream whose buffers point into the mapping. The
+   stream is only valid as long as this object is, and rewind() starts it over
+   for another scan.
+*/
+class QDuckdbArrowIpcFile
+{
+public:
+    explicit QDuckdbArrowIpcFile(const QString &fileName);
+
+    bool open();
+    void exportStream(ArrowArrayStream *stream);
+    void rewind() { nextBatch = 0; }
+    QString errorString() const { return error; }
+
+private:
+    struct SchemaNode
+    {
+        QByteArray format;
+        QByteArray name;
+        QDuckdbArrowFormat parsed;
+        std::vector<SchemaNode *> fields;
+        std::vector<ArrowSchema *> children;
+        ArrowSchema schema;
+    };
+    struct ArrayNode
+    {
+        std::vector<const void *> buffers;
+        std::vector<ArrowArray *> children;
+        ArrowArray array;
+    };
+    class Table;
+
+    bool readMessage(qint64 offset, Table *message, qint64 *bodyStart, qint64 *next);
+    SchemaNode *readSchema(const Table &schema);
+    SchemaNode *readField(const Table &field, int depth);
+    bool readBatch(const Table &message, qint64 bodyStart);
+    ArrowArray *readArray(const SchemaNode *field, const Table &batch, qint64 bodyStart,
+                          qint64 *node, qint64 *buffer);
+
+    static int getSchema(ArrowArrayStream *stream, ArrowSchema *out);
+    static int getNext(ArrowArrayStream *stream, ArrowArray *out);
+    static const char *getLastError(ArrowArrayStream *stream);
+    static void release(ArrowArrayStream *stream);
+
+    QFile file;
+    const uchar *data = nullptr;
+    qint64 size = 0;
+    SchemaNode *root = nullptr;
+    std::deque<SchemaNode> schemaNodes;
+    std::deque<ArrayNode> arrayNodes;
+    QVector<ArrowArray *> batches;
+    int nextBatch = 0;
+    QString error;
+};
+
+QT_END_NAMESPACE
+
+#endif // QSQL_DUCKDB_ARROW_IPC_P_H
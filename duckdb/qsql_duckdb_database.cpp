@@ -0,0 +1,456 @@
+#include "qsql_duckdb_database_p.h"
+
+#include <qcoreapplication.h>
+#include <qdir.h>
+#include <qfileinfo.h>
+#include <qthread.h>
+
+#include <algorithm>
+
+QT_BEGIN_NAMESPACE
+
+/*
+   Checks the policy a few times per idle period on a connection of its own and
+   runs CHECKPOINT when it is due. FORCE CHECKPOINT is not used, it would abort
+   the transactions of the application; a checkpoint that fails because one is
+   running is tried again at the next check.
+*/
+class QDuckdbCheckpointer : public QThread
+{
+public:
+    QDuckdbCheckpointer(QDuckdbDatabase *database, qint64 walLimit, int idleMSecs)
+        : database(database), walLimit(walLimit), idleMSecs(idleMSecs)
+    {
+        setObjectName(QStringLiteral("QDuckdbCheckpointer"));
+    }
+    ~QDuckdbCheckpointer()
+    {
+        {
+            QMutexLocker locker(&mutex);
+            stopping = true;
+            wakeUp.wakeAll();
+        }
+        wait();
+        if (connection)
+            duckdb_disconnect(&connection);
+    }
+
+    void run() override;
+
+    QDuckdbDatabase *database;
+    duckdb_connection connection = nullptr;
+    const qint64 walLimit;
+    const int idleMSecs;
+    QMutex mutex;
+    QWaitCondition wakeUp;
+    bool stopping = false;
+};
+
+void QDuckdbCheckpointer::run()
+{
+    const unsigned long interval = idleMSecs > 0 ? qBound(10, idleMSecs / 4, 1000) : 100;
+    QMutexLocker locker(&mutex);
+    while (!stopping) {
+        wakeUp.wait(&mutex, interval);
+        if (stopping)
+            break;
+        locker.unlock();
+
+        const qint64 wal = database->walSize();
+        const bool due = wal > 0 && ((walLimit > 0 && wal >= walLimit)
+                                     || (idleMSecs > 0 && database->idleMSecs() >= idleMSecs));
+        if (due) {
+            QElapsedTimer timer;
+            timer.start();
+            duckdb_result result;
+            const bool ok = duckdb_query(connection, "CHECKPOINT", &result) == DuckDBSuccess;
+            duckdb_destroy_result(&result);
+            const qint64 elapsed = timer.elapsed();
+            if (ok) {
+                database->checkpoints.fetchAndAddRelaxed(1);
+                database->lastCheckpointMSecs.storeRelaxed(elapsed);
+                if (elapsed > database->maxCheckpointMSecs.loadRelaxed())
+                    database->maxCheckpointMSecs.storeRelaxed(elapsed);
+            } else {
+                database->failedCheckpoints.fetchAndAddRelaxed(1);
+            }
+        }
+        locker.relock();
+    }
+}
+
+// the open databases by file, guarded by qDatabasesMutex
+typedef QHash<QString, QDuckdbDatabase *> QDuckdbDatabaseHash;
+Q_GLOBAL_STATIC(QDuckdbDatabaseHash, qDatabases)
+Q_GLOBAL_STATIC(QMutex, qDatabasesMutex)
+
+// in-memory databases are private to the connection that opens them
+static bool qIsMemoryDatabase(const QString &path)
+{
+    return path.isEmpty() || path.startsWith(QLatin1String(":memory:"));
+}
+
+static QString qDatabaseKey(const QString &path)
+{
+    const QFileInfo info(path);
+    const QString canonical = info.canonicalFilePath();
+    return QDir::cleanPath(canonical.isEmpty() ? info.absoluteFilePath() : canonical);
+}
+
+QDuckdbDatabase *QDuckdbDatabase::acquire(const QString &path, duckdb_config config, bool readOnly, QString *error)
+{
+    const bool shared = !qIsMemoryDatabase(path);
+    const QString key = shared ? qDatabaseKey(path) : QString();
+
+    // held while opening, so that a concurrent acquire of the same file waits for this one
+    QMutexLocker locker(qDatabasesMutex());
+    if (shared) {
+        QDuckdbDatabase *database = qDatabases()->value(key);
+        if (database && database->readOnly != readOnly) {
+            if (error)
+                *error = database->readOnly
+                        ? QCoreApplication::translate("QDuckdbDriver", "The database is already open read-only")
+                        : QCoreApplication::translate("QDuckdbDriver", "The database is already open for writing");
+            return nullptr;
+        }
+        if (database) {
+            ++database->refs;
+            return database;
+        }
+    }
+
+    QDuckdbDatabase *database = new QDuckdbDatabase;
+    database->clock.start();
+    char *message = nullptr;
+    if (duckdb_open_ext(path.toUtf8().constData(), &database->database, config, &message) == DuckDBError) {
+        if (error)
+            *error = QString::fromUtf8(message);
+        if (message)
+            duckdb_free(message);
+        delete database;
+        return nullptr;
+    }
+    database->filePath = key;
+    database->readOnly = readOnly;
+    if (shared)
+        qDatabases()->insert(key, database);
+    return database;
+}
+
+QDuckdbDatabase *QDuckdbDatabase::adopt(duckdb_database handle)
+{
+    QDuckdbDatabase *database = new QDuckdbDatabase;
+    database->clock.start();
+    database->database = handle;
+    database->owned = false;
+    return database;
+}
+
+void QDuckdbDatabase::retain()
+{
+    QMutexLocker locker(qDatabasesMutex());
+    ++refs;
+}
+
+void QDuckdbDatabase::release()
+{
+    QMutexLocker locker(qDatabasesMutex());
+    if (--refs > 0)
+        return;
+    if (!filePath.isEmpty() && qDatabases()->value(filePath) == this)
+        qDatabases()->remove(filePath);
+    // closed under the lock, the file is free again before the next acquire opens it
+    delete this;
+}
+
+QDuckdbDatabase::~QDuckdbDatabase()
+{
+    // the checkpoint connection has to go before the database
+    delete checkpointer;
+    openGroup.reset();
+    if (owned && database)
+        duckdb_close(&database);
+}
+
+/*
+   Invalidation bumps the version first, so a lookup that read the old version
+   before the DDL ran cannot store its stale result afterwards.
+*/
+void QDuckdbDatabase::invalidateSchema()
+{
+    QMutexLocker locker(&mutex);
+    version.fetchAndAddOrdered(1);
+    tableInfo.clear();
+    tableNames.clear();
+}
+
+bool QDuckdbDatabase::cachedTable(const QString &name, QDuckdbTableInfo *info) const
+{
+    QMutexLocker locker(&mutex);
+    const auto it = tableInfo.constFind(name);
+    if (it == tableInfo.constEnd())
+        return false;
+    *info = it.value();
+    return true;
+}
+
+void QDuckdbDatabase::cacheTable(const QString &name, quint64 version, const QDuckdbTableInfo &info)
+{
+    QMutexLocker locker(&mutex);
+    if (version == this->version.loadAcquire())
+        tableInfo.insert(name, info);
+}
+
+bool QDuckdbDatabase::cachedTables(int type, QStringList *names) const
+{
+    QMutexLocker locker(&mutex);
+    const auto it = tableNames.constFind(type);
+    if (it == tableNames.constEnd())
+        return false;
+    *names = it.value();
+    return true;
+}
+
+void QDuckdbDatabase::cacheTables(int type, quint64 version, const QStringList &names)
+{
+    QMutexLocker locker(&mutex);
+    if (version == this->version.loadAcquire())
+        tableNames.insert(type, names);
+}
+
+QSharedPointer<QDuckdbCommitGroup> QDuckdbDatabase::joinCommitGroup(int windowMSecs, int *member, QString *error)
+{
+    QMutexLocker locker(&groupMutex);
+    // a thread already running in the open group would wait for itself, it begins a group of its own
+    const Qt::HANDLE thread = QThread::currentThreadId();
+    if (openGroup && !openGroup->failed && openGroup->opened.elapsed() < openGroup->window
+            && !openGroup->threads.contains(thread)) {
+        *member = openGroup->members++;
+        openGroup->running.append(*member);
+        openGroup->threads.append(thread);
+        return openGroup;
+    }
+
+    QSharedPointer<QDuckdbCommitGroup> group = QSharedPointer<QDuckdbCommitGroup>::create();
+    if (duckdb_connect(database, &group->connection) == DuckDBError) {
+        group->connection = nullptr;
+        if (error)
+            *error = QCoreApplication::translate("QDuckdbDriver", "Unable to connect the commit group");
+        return QSharedPointer<QDuckdbCommitGroup>();
+    }
+    duckdb_result result;
+    if (duckdb_query(group->connection, "BEGIN TRANSACTION", &result) == DuckDBError) {
+        if (error)
+            *error = QString::fromUtf8(duckdb_result_error(&result));
+        duckdb_destroy_result(&result);
+        return QSharedPointer<QDuckdbCommitGroup>();
+    }
+    duckdb_destroy_result(&result);
+    group->window = windowMSecs;
+    group->members = 1;
+    group->running.append(0);
+    group->threads.append(thread);
+    group->opened.start();
+    openGroup = group;
+    *member = 0;
+    return group;
+}
+
+bool QDuckdbDatabase::commitGroupMemberActive(const QSharedPointer<QDuckdbCommitGroup> &group, int member)
+{
+    QMutexLocker locker(&groupMutex);
+    return !group->done && !group->ending && !group->failed && !group->dropped.contains(member);
+}
+
+/*
+   DuckDB has no savepoints, and a failed statement aborts the transaction it
+   runs in, so the transaction is begun again and the writes of the members
+   still in the group are replayed in their order. A write that fails on replay
+   drops its member too, and the replay starts over without it.
+*/
+void QDuckdbDatabase::dropCommitGroupMember(const QSharedPointer<QDuckdbCommitGroup> &group, int member)
+{
+    QVector<int> dropped;
+    {
+        QMutexLocker locker(&groupMutex);
+        if (group->done || group->failed || group->dropped.contains(member))
+            return;
+        group->dropped.append(member);
+        dropped = group->dropped;
+    }
+
+    QString error;
+    for (bool rebuilt = false; !rebuilt;) {
+        duckdb_result result;
+        duckdb_query(group->connection, "ROLLBACK", &result);
+        duckdb_destroy_result(&result);
+        if (duckdb_query(group->connection, "BEGIN TRANSACTION", &result) == DuckDBError) {
+            error = QString::fromUtf8(duckdb_result_error(&result));
+            duckdb_destroy_result(&result);
+            break;
+        }
+        duckdb_destroy_result(&result);
+
+        rebuilt = true;
+        for (const QDuckdbCommitGroup::Statement &statement : qAsConst(group->statements)) {
+            if (dropped.contains(statement.member))
+                continue;
+            if (!statement.replay(group->connection)) {
+                dropped.append(statement.member);
+                rebuilt = false;
+                break;
+            }
+        }
+    }
+    group->statements.erase(std::remove_if(group->statements.begin(), group->statements.end(),
+                                           [&dropped](const QDuckdbCommitGroup::Statement &statement) {
+                                               return dropped.contains(statement.member);
+                                           }),
+                            group->statements.end());
+
+    QMutexLocker locker(&groupMutex);
+    group->dropped = dropped;
+    if (!error.isEmpty()) {
+        group->failed = true;
+        group->error = error;
+    }
+    groupChanged.wakeAll();
+}
+
+/*
+   Members that finish early wait for the window to pass, since others may still
+   join, and then for the members still running statements, up to timeoutMSecs.
+   The members still running then are dropped; their later statements and their
+   commit fail, and nothing runs on the group connection after the commit.
+*/
+bool QDuckdbDatabase::finishCommitGroup(const QSharedPointer<QDuckdbCommitGroup> &group, int member, bool commit,
+                                        int timeoutMSecs, QString *error)
+{
+    // a rollback leaves the work of the other members in place
+    if (!commit) {
+        QMutexLocker statements(&group->statementMutex);
+        dropCommitGroupMember(group, member);
+    }
+
+    QMutexLocker locker(&groupMutex);
+    ++group->finished;
+    group->running.removeOne(member);
+    group->threads.removeOne(QThread::currentThreadId());
+    groupChanged.wakeAll();
+
+    while (!group->done) {
+        const qint64 remaining = group->window - group->opened.elapsed();
+        if (remaining > 0 && !group->failed) {
+            groupChanged.wait(&groupMutex, static_cast<unsigned long>(remaining));
+            continue;
+        }
+        if (openGroup == group)
+            openGroup.reset();
+        if (group->ending) {
+            groupChanged.wait(&groupMutex);
+            continue;
+        }
+        if (!group->running.isEmpty() && !group->failed) {
+            const qint64 stall = group->window + qMax(timeoutMSecs, 0) - group->opened.elapsed();
+            if (stall > 0) {
+                groupChanged.wait(&groupMutex, static_cast<unsigned long>(stall));
+                continue;
+            }
+        }
+
+        // the last member ends the transaction, once the statements running on the connection are done
+        const QVector<int> stragglers = group->running;
+        group->ending = true;
+        locker.unlock();
+        {
+            QMutexLocker statements(&group->statementMutex);
+            for (int straggler : stragglers)
+                dropCommitGroupMember(group, straggler);
+            locker.relock();
+            const bool failed = group->failed;
+            locker.unlock();
+            duckdb_result result;
+            QString message;
+            if (duckdb_query(group->connection, failed ? "ROLLBACK" : "COMMIT", &result) == DuckDBError)
+                message = QString::fromUtf8(duckdb_result_error(&result));
+            duckdb_destroy_result(&result);
+            locker.relock();
+            if (!failed && !message.isEmpty()) {
+                group->failed = true;
+                group->error = message;
+            }
+            group->done = true;
+            groupChanged.wakeAll();
+        }
+    }
+
+    if (error) {
+        if (group->failed)
+            *error = group->error;
+        else if (group->dropped.contains(member))
+            *error = QCoreApplication::translate("QDuckdbDriver", "The transaction was dropped from its commit group");
+    }
+    return !group->failed && !group->dropped.contains(member);
+}
+
+bool QDuckdbDatabase::startCheckpoints(qint64 walLimit, int idleMSecs, QString *error)
+{
+    QMutexLocker locker(&mutex);
+    if (checkpointer || filePath.isEmpty())
+        return true;
+
+    QScopedPointer<QDuckdbCheckpointer> thread(new QDuckdbCheckpointer(this, walLimit, idleMSecs));
+    if (duckdb_connect(database, &thread->connection) == DuckDBError) {
+        thread->connection = nullptr;
+        if (error)
+            *error = QCoreApplication::translate("QDuckdbDriver", "Unable to connect the checkpointer");
+        return false;
+    }
+    // well above the limit, the automatic checkpoint in a commit is only a safety net now
+    const qint64 threshold = walLimit > 0 ? walLimit * 4 : qint64(1) << 30;
+    const QByteArray sql = QByteArray("SET GLOBAL checkpoint_threshold = '")
+            + QByteArray::number(qMax<qint64>(1, threshold >> 20)) + QByteArray("MiB'");
+    duckdb_result result;
+    if (duckdb_query(thread->connection, sql.constData(), &result) == DuckDBError) {
+        if (error)
+            *error = QString::fromUtf8(duckdb_result_error(&result));
+        duckdb_destroy_result(&result);
+        return false;
+    }
+    duckdb_destroy_result(&result);
+    checkpointer = thread.take();
+    checkpointer->start(QThread::LowPriority);
+    return true;
+}
+
+void QDuckdbDatabase::addListener(QDuckdbChangeListener *listener)
+{
+    QMutexLocker locker(&listenerMutex);
+    if (!listeners.contains(listener))
+        listeners.append(listener);
+    listenerCount.storeRelaxed(listeners.size());
+}
+
+void QDuckdbDatabase::removeListener(QDuckdbChangeListener *listener)
+{
+    QMutexLocker locker(&listenerMutex);
+    listeners.removeOne(listener);
+    listenerCount.storeRelaxed(listeners.size());
+}
+
+void QDuckdbDatabase::notifyChange(const QString &table, qint64 rows, const QDuckdbChangeListener *origin)
+{
+    QMutexLocker locker(&listenerMutex);
+    for (QDuckdbChangeListener *listener : qAsConst(listeners))
+        listener->tableChanged(table, rows, listener == origin);
+}
+
+qint64 QDuckdbDatabase::walSize() const
+{
+    if (filePath.isEmpty())
+        return 0;
+    const QFileInfo wal(filePath + QLatin1String(".wal"));
+    return wal.exists() ? wal.size() : 0;
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,186 @@
+#ifndef QSQL_DUCKDB_DATABASE_P_H
+#define QSQL_DUCKDB_DATABASE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/qatomic.h>
+#include <QtCore/qelapsedtimer.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qmutex.h>
+#include <QtCore/qsharedpointer.h>
+#include <QtCore/qstring.h>
+#include <QtCore/qstringlist.h>
+#include <QtCore/qvector.h>
+#include <QtCore/qwaitcondition.h>
+#include <QtSql/qsqlindex.h>
+#include <QtSql/qsqlrecord.h>
+
+#include "duckdb.h"
+
+#include <functional>
+
+QT_BEGIN_NAMESPACE
+
+class QDuckdbCheckpointer;
+
+struct QDuckdbTableInfo
+{
+    QSqlRecord record;
+    QSqlIndex primaryIndex;
+};
+
+// told about the rows changed in the tables of a database by any of its connections
+class QDuckdbChangeListener
+{
+public:
+    virtual ~QDuckdbChangeListener() = default;
+    // runs on the thread that made the change, self if it was made through this listener's connection
+    virtual void tableChanged(const QString &table, qint64 rows, bool self) = 0;
+};
+
+/*
+   One DuckDB transaction shared by the writers that begin a transaction within
+   the same window. It runs on a connection of its own and commits when every
+   member has finished, so the members pay for a single WAL flush. The members'
+   statements run one at a time and, being in one transaction, see each other's
+   uncommitted rows. A member that rolls back, whose statement fails, or that
+   has not finished long after the window is dropped: the transaction is rolled
+   back and begun again with the writes of the other members replayed.
+*/
+struct QDuckdbCommitGroup
+{
+    ~QDuckdbCommitGroup()
+    {
+        if (connection)
+            duckdb_disconnect(&connection);
+    }
+
+    // a write of a member, run again on connection when the transaction is rebuilt
+    struct Statement
+    {
+        int member;
+        std::function<bool(duckdb_connection)> replay;
+    };
+
+    duckdb_connection connection = nullptr;
+    // held by a member for each use of connection, before groupMutex when both are taken
+    QRecursiveMutex statementMutex;
+    // guarded by statementMutex
+    QVector<Statement> statements;
+
+    // guarded by the groupMutex of the database
+    QElapsedTimer opened;
+    int window = 0;
+    int members = 0;
+    int finished = 0;
+    // the members still running and their threads, a thread never waits for itself
+    QVector<int> running;
+    QVector<Qt::HANDLE> threads;
+    QVector<int> dropped;
+    bool failed = false;
+    bool ending = false;
+    bool done = false;
+    QString error;
+};
+
+/*
+   A database file opened once per process and shared by every driver that
+   connects to it; DuckDB holds a lock on the file, so a second instance could
+   not open it anyway. The options of the first open apply to all connections,
+   a later open asking for another access mode fails.
+   State that belongs to the database rather than to a connection, like the
+   schema cache, lives here and is guarded by its own mutex.
+*/
+class QDuckdbDatabase
+{
+public:
+    // the shared instance for path, opened with config on first use, with a reference for the caller
+    static QDuckdbDatabase *acquire(const QString &path, duckdb_config config, bool readOnly, QString *error);
+    // wraps a handle owned by the caller, it is not shared and not closed
+    static QDuckdbDatabase *adopt(duckdb_database handle);
+    // takes another reference, for a connection of the driver's own
+    void retain();
+    // drops a reference, the last one closes the database
+    void release();
+
+    duckdb_database *handle() { return &database; }
+    QString path() const { return filePath; }
+
+    // Schema cache of persistent tables and views, keyed by the name callers
+    // asked for. Entries are only stored if no DDL ran since version was read.
+    quint64 schemaVersion() const { return version.loadAcquire(); }
+    void invalidateSchema();
+    bool cachedTable(const QString &name, QDuckdbTableInfo *info) const;
+    void cacheTable(const QString &name, quint64 version, const QDuckdbTableInfo &info);
+    bool cachedTables(int type, QStringList *names) const;
+    void cacheTables(int type, quint64 version, const QStringList &names);
+
+    // Group commit: joins the group still open for new members or begins a new one
+    // that accepts members for windowMSecs, member identifies the caller in the group.
+    QSharedPointer<QDuckdbCommitGroup> joinCommitGroup(int windowMSecs, int *member, QString *error);
+    // whether the statements of member may still run, false once it was dropped or the group ended
+    bool commitGroupMemberActive(const QSharedPointer<QDuckdbCommitGroup> &group, int member);
+    // Rebuilds the transaction without the writes of member, with statementMutex held.
+    // Other members whose writes cannot be replayed are dropped as well.
+    void dropCommitGroupMember(const QSharedPointer<QDuckdbCommitGroup> &group, int member);
+    // Ends the membership and waits for the group to end, the last member to finish
+    // after the window commits for all of them. A rollback only drops the member, and
+    // members still running timeoutMSecs after the window are dropped.
+    bool finishCommitGroup(const QSharedPointer<QDuckdbCommitGroup> &group, int member, bool commit,
+                           int timeoutMSecs, QString *error);
+
+    // Background checkpoints: raises checkpoint_threshold so that commits stop checkpointing
+    // and checkpoints from a thread of its own once the WAL reaches walLimit bytes or no
+    // statement ran for idleMSecs. Only the first call starts it, file databases only.
+    bool startCheckpoints(qint64 walLimit, int idleMSecs, QString *error);
+    void noteActivity() { lastActivity.storeRelaxed(clock.elapsed()); }
+    qint64 idleMSecs() const { return clock.elapsed() - lastActivity.loadRelaxed(); }
+    qint64 walSize() const;
+    QAtomicInteger<quint64> checkpoints;
+    QAtomicInteger<quint64> failedCheckpoints;
+    QAtomicInteger<qint64> lastCheckpointMSecs;
+    QAtomicInteger<qint64> maxCheckpointMSecs;
+
+    // Change notifications. Changes are only tracked while somebody listens; once
+    // removeListener() returns the listener is not called any more.
+    bool hasListeners() const { return listenerCount.loadRelaxed() > 0; }
+    void addListener(QDuckdbChangeListener *listener);
+    void removeListener(QDuckdbChangeListener *listener);
+    void notifyChange(const QString &table, qint64 rows, const QDuckdbChangeListener *origin);
+
+private:
+    QDuckdbDatabase() = default;
+    ~QDuckdbDatabase();
+
+    duckdb_database database = nullptr;
+    bool owned = true;
+    bool readOnly = false;
+    QString filePath;
+    int refs = 1;
+    QAtomicInteger<quint64> version;
+    mutable QMutex mutex;
+    QHash<QString, QDuckdbTableInfo> tableInfo;
+    QHash<int, QStringList> tableNames;
+    QMutex groupMutex;
+    QWaitCondition groupChanged;
+    QSharedPointer<QDuckdbCommitGroup> openGroup;
+    QElapsedTimer clock;
+    QAtomicInteger<qint64> lastActivity;
+    QDuckdbCheckpointer *checkpointer = nullptr;
+    QMutex listenerMutex;
+    QVector<QDuckdbChangeListener *> listeners;
+    QAtomicInt listenerCount;
+};
+
+QT_END_NAMESPACE
+
+#endif // QSQL_DUCKDB_DATABASE_P_H
@@ -51,20 +51,125 @@
 // We mean it.
 //
 
+#include <QtCore/qfuture.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qvector.h>
 #include <QtSql/qsqldriver.h>
+#include <QtSql/qsqlerror.h>
+#include <QtSql/qsqlindex.h>
+#include <QtSql/private/qsqlcachedresult_p.h>
 
 #include "duckdb.h"
 
+#include <functional>
+
 #ifdef QT_PLUGIN
 #define Q_EXPORT_SQLDRIVER_SQLITE
 #else
 #define Q_EXPORT_SQLDRIVER_SQLITE Q_SQL_EXPORT
 #endif
 
+struct ArrowSchema;
+struct ArrowArray;
+struct ArrowArrayStream;
+
 QT_BEGIN_NAMESPACE
 
+class QIODevice;
 class QSqlResult;
+class QDuckdbDriver;
 class QDuckdbDriverPrivate;
+class QDuckdbResultPrivate;
+class QDuckdbWriteQueuePrivate;
+
+class Q_EXPORT_SQLDRIVER_SQLITE QDuckdbResult : public QSqlCachedResult
+{
+    Q_DECLARE_PRIVATE(QDuckdbResult)
+    friend class QDuckdbDriver;
+
+public:
+    enum ArrowIpcFormat { ArrowIpcStream, ArrowIpcFile };
+
+    explicit QDuckdbResult(const QDuckdbDriver* db);
+    ~QDuckdbResult();
+    QVariant handle() const override;
+
+    // the materialized result of the last exec(), nullptr if there is none
+    duckdb_result *resultHandle() const;
+    // writes every row into the gadget returned by append, columns map to properties by name
+    bool readGadgets(const QMetaObject &metaObject, const std::function<void *()> &append) const;
+    // Arrow C data interface export of the result set, the caller releases the structs.
+    // The stream yields one array per result chunk and is valid as long as this result set is.
+    bool exportArrowSchema(ArrowSchema *schema) const;
+    bool exportArrowStream(ArrowArrayStream *stream) const;
+    // serializes the result set as Arrow IPC, one record batch per chunk
+    bool exportArrowIpc(QIODevice *device, ArrowIpcFormat format = ArrowIpcStream) const;
+    // writes the BLOB column of the current row to device in bounded steps
+    bool writeBlob(int column, QIODevice *device);
+    // Typed reads of the current row straight from the result chunk, without a QVariant.
+    // The string view is valid until the next call for the same column or the next row.
+    bool isNullAt(int column) const;
+    qint64 int64At(int column) const;
+    double doubleAt(int column) const;
+    QStringView stringAt(int column) const;
+
+protected:
+    bool gotoNext(QSqlCachedResult::ValueCache& row, int idx) override;
+    QVariant data(int i) override;
+    bool isNull(int i) override;
+    bool reset(const QString &query) override;
+    bool prepare(const QString &query) override;
+    bool execBatch(bool arrayBind) override;
+    bool exec() override;
+    bool nextResult() override;
+    int size() override;
+    int numRowsAffected() override;
+    QVariant lastInsertId() const override;
+    QSqlRecord record() const override;
+    void detachFromResultSet() override;
+    void virtual_hook(int id, void *data) override;
+
+private:
+    // binds and runs the current statement of the query, appending its result
+    bool execStatement();
+    // makes the result of statement index the current result set
+    bool showResult(int index);
+};
+
+/*
+   Rows for one table, queued by any number of threads without taking a lock
+   and written behind by a thread of its own through a DuckDB appender, which
+   is flushed when flushRows rows are waiting or the oldest has waited
+   flushMSecs. At most maxPendingRows rows are queued or unflushed at a time.
+*/
+class Q_EXPORT_SQLDRIVER_SQLITE QDuckdbWriteQueue
+{
+public:
+    // flushes the queued rows and stops the writer
+    ~QDuckdbWriteQueue();
+
+    // Queues the values of one row in table column order; an invalid QVariant, and a
+    // missing trailing value, stands for the column default. Waits while the queue is
+    // full, at most timeout ms unless it is negative, and returns false on timeout or
+    // if the row has more values than the table has columns.
+    bool enqueue(const QVector<QVariant> &row, int timeout = -1);
+    bool enqueue(QVector<QVariant> &&row, int timeout = -1);
+    // queues a gadget, columns are read from the properties of the same name
+    bool enqueueGadget(const QMetaObject &metaObject, const void *gadget, int timeout = -1);
+    // The outcome of the flush that writes every row queued before; the flush happens
+    // at once, or with the next one due to the thresholds if immediately is false.
+    QFuture<bool> flush(bool immediately = true);
+
+    QStringList columns() const;
+    // the error of the last flush that failed
+    QSqlError lastError() const;
+
+private:
+    friend class QDuckdbDriver;
+    explicit QDuckdbWriteQueue(QDuckdbWriteQueuePrivate *d);
+    Q_DISABLE_COPY(QDuckdbWriteQueue)
+    QDuckdbWriteQueuePrivate *d;
+};
 
 class Q_EXPORT_SQLDRIVER_SQLITE QDuckdbDriver : public QSqlDriver
 {
@@ -87,18 +192,62 @@ public:
     bool beginTransaction() override;
     bool commitTransaction() override;
     bool rollbackTransaction() override;
+    // Runs work in a transaction, which is rolled back if work returns false, and runs it
+    // again, up to maxRetries times, while it fails with a conflict with another transaction.
+    bool runTransaction(const std::function<bool()> &work, int maxRetries = 5);
+    // conflicts retried, and transactions given up after maxRetries, by runTransaction()
+    quint64 transactionRetries() const;
+    quint64 transactionAborts() const;
+    struct CheckpointStats
+    {
+        qint64 walSize;
+        quint64 checkpoints;
+        quint64 failedCheckpoints;
+        qint64 lastCheckpointMSecs;
+        qint64 maxCheckpointMSecs;
+    };
+    // the WAL of the database file and the checkpoints run in the background so far
+    CheckpointStats checkpointStats() const;
     QStringList tables(QSql::TableType) const override;
 
     QSqlRecord record(const QString& tablename) const override;
     QSqlIndex primaryIndex(const QString &table) const override;
+    // records and primary indexes of the tables and views whose name matches the LIKE pattern,
+    // all of them if it is empty, read with one catalog query
+    bool readTableInfo(const QString &pattern, QHash<QString, QSqlRecord> *records,
+                       QHash<QString, QSqlIndex> *primaryIndexes = nullptr);
     QVariant handle() const override;
+    struct ScriptStatement
+    {
+        duckdb_statement_type type;
+        qint64 rowsChanged;
+        qint64 elapsedNSecs;
+    };
+    // runs the statements of script in order and stops at the first one that fails,
+    // statements receives one entry per statement that ran
+    bool runScript(const QString &script, QVector<ScriptStatement> *statements = nullptr);
+    // appends count gadgets laid out stride bytes apart through a DuckDB appender
+    bool appendGadgets(const QString &table, const QMetaObject &metaObject,
+                       const void *gadgets, int count, int stride);
+    // a write behind queue for table on a connection of its own, the caller deletes it
+    QDuckdbWriteQueue *createWriteQueue(const QString &table, int flushRows = 10000, int flushMSecs = 100,
+                                        int maxPendingRows = 100000);
+    // scans Arrow data once into the temporary table name, the caller keeps ownership
+    bool registerArrowStream(const QString &name, ArrowArrayStream *stream);
+    bool registerArrowArray(const QString &name, ArrowSchema *schema, ArrowArray *array);
+    // memory maps an Arrow IPC stream or file as the temporary view name, each query scans the
+    // mapping again and the file stays mapped, so unchanged, until the connection closes
+    bool registerArrowIpcFile(const QString &name, const QString &fileName);
     QString escapeIdentifier(const QString &identifier, IdentifierType) const override;
 
     bool subscribeToNotification(const QString &name) override;
     bool unsubscribeFromNotification(const QString &name) override;
     QStringList subscribedToNotifications() const override;
 private Q_SLOTS:
-    void handleNotification(const QString &tableName, qint64 rowid);
+    void emitNotifications();
+private:
+    void handleNotification(const QString &tableName, qint64 rows, NotificationSource source);
+    bool materializeArrowScan(const QByteArray &view, const QString &name);
 };
 
 QT_END_NAMESPACE
@@ -0,0 +1,520 @@
+#ifndef QSQL_DUCKDB_ROWS_H
+#define QSQL_DUCKDB_ROWS_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/qbytearray.h>
+#include <QtCore/qdatetime.h>
+#include <QtCore/qdebug.h>
+#include <QtCore/qpair.h>
+#include <QtCore/qstring.h>
+#include <QtCore/qvector.h>
+#include <QtSql/qsqldatabase.h>
+#include <QtSql/qsqlquery.h>
+
+#include "qsql_duckdb_p.h"
+#include "qsql_duckdb_arrow.h"
+
+#include <cmath>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+
+namespace QDuckdb {
+
+// a result column as the decoders see it, DECIMAL values are integers of type storage scaled by scale
+struct Column
+{
+    duckdb_type type;
+    duckdb_type storage;
+    quint8 scale;
+};
+
+namespace Private {
+
+// the size in bytes of an integer type, 0 for other types
+inline int integerSize(duckdb_type type, bool *isSigned)
+{
+    *isSigned = type == DUCKDB_TYPE_TINYINT || type == DUCKDB_TYPE_SMALLINT
+            || type == DUCKDB_TYPE_INTEGER || type == DUCKDB_TYPE_BIGINT;
+    switch (type) {
+    case DUCKDB_TYPE_TINYINT:
+    case DUCKDB_TYPE_UTINYINT:
+        return 1;
+    case DUCKDB_TYPE_SMALLINT:
+    case DUCKDB_TYPE_USMALLINT:
+        return 2;
+    case DUCKDB_TYPE_INTEGER:
+    case DUCKDB_TYPE_UINTEGER:
+        return 4;
+    case DUCKDB_TYPE_BIGINT:
+    case DUCKDB_TYPE_UBIGINT:
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+// whether T holds every value of an integer column of type
+template <typename T>
+bool integerFits(duckdb_type type)
+{
+    bool isSigned;
+    const int size = integerSize(type, &isSigned);
+    if (size == 0)
+        return false;
+    if (std::is_signed<T>::value)
+        return size < int(sizeof(T)) || (isSigned && size == int(sizeof(T)));
+    return !isSigned && size <= int(sizeof(T));
+}
+
+// a cell of an integer column of any width, the type is constant per column so the switch predicts well
+template <typename T>
+T readInteger(duckdb_type type, const void *data, idx_t row)
+{
+    switch (type) {
+    case DUCKDB_TYPE_TINYINT:
+        return T(static_cast<const qint8 *>(data)[row]);
+    case DUCKDB_TYPE_SMALLINT:
+        return T(static_cast<const qint16 *>(data)[row]);
+    case DUCKDB_TYPE_INTEGER:
+        return T(static_cast<const qint32 *>(data)[row]);
+    case DUCKDB_TYPE_BIGINT:
+        return T(static_cast<const qint64 *>(data)[row]);
+    case DUCKDB_TYPE_UTINYINT:
+        return T(static_cast<const quint8 *>(data)[row]);
+    case DUCKDB_TYPE_USMALLINT:
+        return T(static_cast<const quint16 *>(data)[row]);
+    case DUCKDB_TYPE_UINTEGER:
+        return T(static_cast<const quint32 *>(data)[row]);
+    default:
+        return T(static_cast<const quint64 *>(data)[row]);
+    }
+}
+
+} // namespace Private
+
+// Maps a C++ type to the DuckDB columns it is read from. Integer columns are
+// accepted by every integer type that holds all their values, and double
+// also reads FLOAT, integer and DECIMAL columns; no conversion loses range.
+template <typename T>
+struct ColumnDecoder;
+
+#define QDUCKDB_PLAIN_DECODER(CppType, DuckType) \
+    template <> \
+    struct ColumnDecoder<CppType> \
+    { \
+        static bool accepts(const Column &column) { return column.type == DuckType; } \
+        static CppType read(const Column &, const void *data, idx_t row) \
+        { return static_cast<const CppType *>(data)[row]; } \
+    };
+
+#define QDUCKDB_INTEGER_DECODER(CppType) \
+    template <> \
+    struct ColumnDecoder<CppType> \
+    { \
+        static bool accepts(const Column &column) { return Private::integerFits<CppType>(column.type); } \
+        static CppType read(const Column &column, const void *data, idx_t row) \
+        { return Private::readInteger<CppType>(column.type, data, row); } \
+    };
+
+QDUCKDB_PLAIN_DECODER(bool, DUCKDB_TYPE_BOOLEAN)
+QDUCKDB_INTEGER_DECODER(qint8)
+QDUCKDB_INTEGER_DECODER(qint16)
+QDUCKDB_INTEGER_DECODER(qint32)
+QDUCKDB_INTEGER_DECODER(qint64)
+QDUCKDB_INTEGER_DECODER(quint8)
+QDUCKDB_INTEGER_DECODER(quint16)
+QDUCKDB_INTEGER_DECODER(quint32)
+QDUCKDB_INTEGER_DECODER(quint64)
+QDUCKDB_PLAIN_DECODER(float, DUCKDB_TYPE_FLOAT)
+
+#undef QDUCKDB_INTEGER_DECODER
+#undef QDUCKDB_PLAIN_DECODER
+
+template <>
+struct ColumnDecoder<double>
+{
+    static bool accepts(const Column &column)
+    {
+        bool isSigned;
+        return column.type == DUCKDB_TYPE_DOUBLE || column.type == DUCKDB_TYPE_FLOAT
+                || column.type == DUCKDB_TYPE_DECIMAL || Private::integerSize(column.type, &isSigned) > 0;
+    }
+    static double read(const Column &column, const void *data, idx_t row)
+    {
+        switch (column.type) {
+        case DUCKDB_TYPE_DOUBLE:
+            return static_cast<const double *>(data)[row];
+        case DUCKDB_TYPE_FLOAT:
+            return static_cast<const float *>(data)[row];
+        case DUCKDB_TYPE_DECIMAL: {
+            const double scale = std::pow(10.0, column.scale);
+            if (column.storage == DUCKDB_TYPE_HUGEINT)
+                return duckdb_hugeint_to_double(static_cast<const duckdb_hugeint *>(data)[row]) / scale;
+            return double(Private::readInteger<qint64>(column.storage, data, row)) / scale;
+        }
+        default:
+            return Private::readInteger<double>(column.type, data, row);
+        }
+    }
+};
+
+// strings shorter than 13 bytes are stored inside the duckdb_string_t itself
+inline const char *stringData(const duckdb_string_t &str)
+{
+    return str.value.inlined.length <= 12 ? str.value.inlined.inlined : str.value.pointer.ptr;
+}
+
+template <>
+struct ColumnDecoder<QString>
+{
+    static bool accepts(const Column &column) { return column.type == DUCKDB_TYPE_VARCHAR; }
+    static QString read(const Column &, const void *data, idx_t row)
+    {
+        const duckdb_string_t &str = static_cast<const duckdb_string_t *>(data)[row];
+        return QString::fromUtf8(stringData(str), int(str.value.inlined.length));
+    }
+};
+
+// The returned array references the chunk, it is only valid inside the callback.
+template <>
+struct ColumnDecoder<QByteArray>
+{
+    static bool accepts(const Column &column)
+    { return column.type == DUCKDB_TYPE_BLOB || column.type == DUCKDB_TYPE_VARCHAR; }
+    static QByteArray read(const Column &, const void *data, idx_t row)
+    {
+        const duckdb_string_t &str = static_cast<const duckdb_string_t *>(data)[row];
+        return QByteArray::fromRawData(stringData(str), int(str.value.inlined.length));
+    }
+};
+
+template <>
+struct ColumnDecoder<QDate>
+{
+    static bool accepts(const Column &column) { return column.type == DUCKDB_TYPE_DATE; }
+    static QDate read(const Column &, const void *data, idx_t row)
+    {
+        // days since 1970-01-01, which is julian day 2440588
+        return QDate::fromJulianDay(static_cast<const duckdb_date *>(data)[row].days + qint64(2440588));
+    }
+};
+
+template <>
+struct ColumnDecoder<QTime>
+{
+    static bool accepts(const Column &column) { return column.type == DUCKDB_TYPE_TIME; }
+    static QTime read(const Column &, const void *data, idx_t row)
+    {
+        return QTime::fromMSecsSinceStartOfDay(int(static_cast<const duckdb_time *>(data)[row].micros / 1000));
+    }
+};
+
+template <>
+struct ColumnDecoder<QDateTime>
+{
+    static bool accepts(const Column &column)
+    { return column.type == DUCKDB_TYPE_TIMESTAMP || column.type == DUCKDB_TYPE_TIMESTAMP_TZ; }
+    static QDateTime read(const Column &, const void *data, idx_t row)
+    {
+        // floored, so that instants before 1970 do not round up to the next millisecond
+        const qint64 micros = static_cast<const duckdb_timestamp *>(data)[row].micros;
+        return QDateTime::fromMSecsSinceEpoch((micros >= 0 ? micros : micros - 999) / 1000, Qt::UTC);
+    }
+};
+
+namespace Private {
+
+inline bool isValid(const uint64_t *validity, idx_t row)
+{
+    return !validity || (validity[row >> 6] & (quint64(1) << (row & 63)));
+}
+
+template <typename T>
+inline T readCell(const Column &column, const void *data, const uint64_t *validity, idx_t row)
+{
+    return isValid(validity, row) ? ColumnDecoder<T>::read(column, data, row) : T();
+}
+
+inline Column resultColumn(duckdb_result *result, idx_t index)
+{
+    duckdb_logical_type logicalType = duckdb_column_logical_type(result, index);
+    Column column = { duckdb_get_type_id(logicalType), DUCKDB_TYPE_INVALID, 0 };
+    if (column.type == DUCKDB_TYPE_DECIMAL) {
+        column.storage = duckdb_decimal_internal_type(logicalType);
+        column.scale = duckdb_decimal_scale(logicalType);
+    }
+    duckdb_destroy_logical_type(&logicalType);
+    return column;
+}
+
+template <typename... Ts, std::size_t... I>
+bool acceptsColumns(const Column *columns, std::index_sequence<I...>)
+{
+    const bool accepted[] = { ColumnDecoder<Ts>::accepts(columns[I])... };
+    for (std::size_t i = 0; i < sizeof...(Ts); ++i) {
+        if (!accepted[i]) {
+            qWarning() << "QDuckdb::forEachRow: column" << i << "has incompatible type" << columns[i].type;
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename... Ts, typename Func, std::size_t... I>
+void forEachRowInChunk(duckdb_data_chunk chunk, const Column *columns, Func &func, std::index_sequence<I...>)
+{
+    const duckdb_vector vectors[] = { duckdb_data_chunk_get_vector(chunk, I)... };
+    const void *data[] = { duckdb_vector_get_data(vectors[I])... };
+    const uint64_t *validity[] = { duckdb_vector_get_validity(vectors[I])... };
+    const idx_t size = duckdb_data_chunk_get_size(chunk);
+    for (idx_t row = 0; row < size; ++row)
+        func(readCell<Ts>(columns[I], data[I], validity[I], row)...);
+}
+
+template <typename T>
+struct ArrowFormat;
+
+#define QDUCKDB_ARROW_FORMAT(CppType, Format) \
+    template <> \
+    struct ArrowFormat<CppType> \
+    { \
+        static const char *format() { return Format; } \
+    };
+
+QDUCKDB_ARROW_FORMAT(qint8, "c")
+QDUCKDB_ARROW_FORMAT(qint16, "s")
+QDUCKDB_ARROW_FORMAT(qint32, "i")
+QDUCKDB_ARROW_FORMAT(qint64, "l")
+QDUCKDB_ARROW_FORMAT(quint8, "C")
+QDUCKDB_ARROW_FORMAT(quint16, "S")
+QDUCKDB_ARROW_FORMAT(quint32, "I")
+QDUCKDB_ARROW_FORMAT(quint64, "L")
+QDUCKDB_ARROW_FORMAT(float, "f")
+QDUCKDB_ARROW_FORMAT(double, "g")
+
+#undef QDUCKDB_ARROW_FORMAT
+
+// the structs are owned by registerColumns(), releasing them frees nothing
+inline void releaseArrowSchema(ArrowSchema *schema) { schema->release = nullptr; }
+inline void releaseArrowArray(ArrowArray *array) { array->release = nullptr; }
+
+// one child of the struct array built by registerColumns()
+struct ArrowColumn
+{
+    QByteArray name;
+    QByteArray utf8;
+    QVector<qint32> offsets;
+    const void *buffers[3];
+    ArrowSchema schema;
+    ArrowArray array;
+};
+
+// fixed size values are handed to DuckDB in place
+template <typename T>
+void initArrowColumn(ArrowColumn *column, const QVector<T> &values)
+{
+    column->schema.format = ArrowFormat<T>::format();
+    column->buffers[0] = nullptr;
+    column->buffers[1] = values.constData();
+    column->array.n_buffers = 2;
+}
+
+inline void initArrowColumn(ArrowColumn *column, const QVector<QString> &values)
+{
+    column->offsets.reserve(values.size() + 1);
+    column->offsets.append(0);
+    for (const QString &value : values) {
+        column->utf8 += value.toUtf8();
+        column->offsets.append(column->utf8.size());
+    }
+    column->schema.format = "u";
+    column->buffers[0] = nullptr;
+    column->buffers[1] = column->offsets.constData();
+    column->buffers[2] = column->utf8.constData();
+    column->array.n_buffers = 3;
+}
+
+} // namespace Private
+
+/*
+   Calls \a func once per row of the executed query in \a result, passing one
+   argument per column decoded as the matching type of \a Ts. The column types
+   are validated once up front; false is returned if they do not match.
+   NULL cells are passed as default constructed values.
+
+   The rows are read straight from the result chunks, independently of the
+   position of the QSqlQuery.
+*/
+template <typename... Ts, typename Func>
+bool forEachRow(const QSqlResult *result, Func &&func)
+{
+    static_assert(sizeof...(Ts) > 0, "forEachRow needs at least one column type");
+
+    const QDuckdbResult *duckdbResult = dynamic_cast<const QDuckdbResult *>(result);
+    duckdb_result *res = duckdbResult ? duckdbResult->resultHandle() : nullptr;
+    if (!res)
+        return false;
+    if (duckdb_column_count(res) != sizeof...(Ts)) {
+        qWarning() << "QDuckdb::forEachRow: expected" << sizeof...(Ts) << "columns, got"
+                   << duckdb_column_count(res);
+        return false;
+    }
+    const auto indexes = std::index_sequence_for<Ts...>();
+    Column columns[sizeof...(Ts)];
+    for (idx_t i = 0; i < sizeof...(Ts); ++i)
+        columns[i] = Private::resultColumn(res, i);
+    if (!Private::acceptsColumns<Ts...>(columns, indexes))
+        return false;
+
+    const idx_t chunkCount = duckdb_result_chunk_count(*res);
+    for (idx_t c = 0; c < chunkCount; ++c) {
+        duckdb_data_chunk chunk = duckdb_result_get_chunk(*res, c);
+        if (!chunk)
+            return false;
+        Private::forEachRowInChunk<Ts...>(chunk, columns, func, indexes);
+        duckdb_destroy_data_chunk(&chunk);
+    }
+    return true;
+}
+
+template <typename... Ts, typename Func>
+bool forEachRow(const QSqlQuery &query, Func &&func)
+{
+    return forEachRow<Ts...>(query.result(), std::forward<Func>(func));
+}
+
+// the DuckDB result of \a query for its typed accessors, nullptr for queries of other drivers
+inline const QDuckdbResult *result(const QSqlQuery &query)
+{
+    return dynamic_cast<const QDuckdbResult *>(query.result());
+}
+
+/*
+   Appends one gadget per row of the executed \a query to \a rows.
+   Columns are assigned to the Q_GADGET properties of the same name, the
+   mapping is resolved once per type and query.
+*/
+template <typename T>
+bool readGadgets(const QSqlQuery &query, QVector<T> *rows)
+{
+    const QDuckdbResult *result = dynamic_cast<const QDuckdbResult *>(query.result());
+    if (!result)
+        return false;
+    return result->readGadgets(T::staticMetaObject, [rows]() -> void * {
+        rows->append(T());
+        return &rows->last();
+    });
+}
+
+/*
+   Inserts \a rows into \a table with the DuckDB appender, table columns are
+   read from the Q_GADGET properties of the same name and get their default
+   value when there is none.
+*/
+template <typename T>
+bool appendGadgets(const QSqlDatabase &db, const QString &table, const QVector<T> &rows)
+{
+    QDuckdbDriver *driver = qobject_cast<QDuckdbDriver *>(db.driver());
+    if (!driver)
+        return false;
+    return driver->appendGadgets(table, T::staticMetaObject, rows.constData(), rows.size(), sizeof(T));
+}
+
+/*
+   Runs \a work on \a db in a transaction and runs it again, after a random
+   pause, while DuckDB aborts it for a conflict with a concurrent writer.
+*/
+inline bool runTransaction(QSqlDatabase &db, const std::function<bool(QSqlDatabase &)> &work, int maxRetries = 5)
+{
+    QDuckdbDriver *driver = qobject_cast<QDuckdbDriver *>(db.driver());
+    if (!driver)
+        return false;
+    return driver->runTransaction([&db, &work]() { return work(db); }, maxRetries);
+}
+
+/*
+   Queues \a gadget on the write behind \a queue, table columns are read from
+   the Q_GADGET properties of the same name and get their default value when
+   there is none.
+*/
+template <typename T>
+bool enqueueGadget(QDuckdbWriteQueue *queue, const T &gadget, int timeout = -1)
+{
+    return queue->enqueueGadget(T::staticMetaObject, &gadget, timeout);
+}
+
+/*
+   Makes \a columns, pairs of name and values, available to SQL as the
+   temporary table \a name with the columns in the same order. All columns
+   must have the same length; they are passed to DuckDB as one Arrow struct
+   array, fixed size values referencing the vectors in place, and copied once
+   into the temporary table.
+*/
+template <typename T>
+bool registerColumns(const QSqlDatabase &db, const QString &name, const QVector<QPair<QString, QVector<T>>> &columns)
+{
+    QDuckdbDriver *driver = qobject_cast<QDuckdbDriver *>(db.driver());
+    if (!driver || columns.isEmpty())
+        return false;
+
+    const int rows = columns.constFirst().second.size();
+    std::vector<Private::ArrowColumn> storage(columns.size());
+    QVector<ArrowSchema *> childSchemas;
+    QVector<ArrowArray *> childArrays;
+    int i = 0;
+    for (auto it = columns.cbegin(); it != columns.cend(); ++it, ++i) {
+        if (it->second.size() != rows) {
+            qWarning() << "QDuckdb::registerColumns: column" << it->first << "has" << it->second.size()
+                       << "rows, expected" << rows;
+            return false;
+        }
+        Private::ArrowColumn &column = storage[i];
+        column.schema = ArrowSchema();
+        column.array = ArrowArray();
+        Private::initArrowColumn(&column, it->second);
+        column.name = it->first.toUtf8();
+        column.schema.name = column.name.constData();
+        column.schema.release = Private::releaseArrowSchema;
+        column.array.length = rows;
+        column.array.buffers = column.buffers;
+        column.array.release = Private::releaseArrowArray;
+        childSchemas.append(&column.schema);
+        childArrays.append(&column.array);
+    }
+
+    const void *structBuffers[1] = { nullptr };
+    ArrowSchema schema = ArrowSchema();
+    schema.format = "+s";
+    schema.name = "";
+    schema.n_children = childSchemas.size();
+    schema.children = childSchemas.data();
+    schema.release = Private::releaseArrowSchema;
+    ArrowArray array = ArrowArray();
+    array.length = rows;
+    array.n_buffers = 1;
+    array.buffers = structBuffers;
+    array.n_children = childArrays.size();
+    array.children = childArrays.data();
+    array.release = Private::releaseArrowArray;
+    return driver->registerArrowArray(name, &schema, &array);
+}
+
+} // namespace QDuckdb
+
+QT_END_NAMESPACE
+
+#endif // QSQL_DUCKDB_ROWS_H
@@ -1,9 +1,49 @@
 #include <QtTest/QtTest>
 #include <QTemporaryDir>
+#include <QBuffer>
 #include <QSqlDatabase>
 #include <QSqlQuery>
 #include <QSqlError>
+#include <QSqlField>
+#include <QSqlRecord>
 
+#include "qsql_duckdb_p.h"
+#include "qsql_duckdb_arrow.h"
+#include "qsql_duckdb_rows.h"
+
+#include <limits>
+#include <thread>
+#include <vector>
+
+struct Product
+{
+    Q_GADGET
+    Q_PROPERTY(int id MEMBER id)
+    Q_PROPERTY(QString name MEMBER name)
+public:
+    int id = 0;
+    QString name;
+};
+
+struct Sample
+{
+    Q_GADGET
+    Q_PROPERTY(qint64 id MEMBER id)
+    Q_PROPERTY(double value MEMBER value)
+    Q_PROPERTY(bool valid MEMBER valid)
+    Q_PROPERTY(QByteArray payload MEMBER payload)
+    Q_PROPERTY(QDate day MEMBER day)
+    Q_PROPERTY(QDateTime taken MEMBER taken)
+    Q_PROPERTY(QTime time MEMBER time)
+public:
+    qint64 id = 0;
+    double value = 0;
+    bool valid = false;
+    QByteArray payload;
+    QDate day;
+    QDateTime taken;
+    QTime time;
+};
 
 class TestDuckdbPlugin: public QObject
 {
@@ -22,6 +62,12 @@ private slots:
             db.setDatabaseName(dbname);
             qCritical() << db.isOpen() << db.isOpenError();
         }
+        // A driver compiled into the test for its C++ extensions, on a file of its own
+        // since it does not share the database instances of the plugin
+        if (!QSqlDatabase::contains("direct")) {
+            QSqlDatabase direct = QSqlDatabase::addDatabase(new QDuckdbDriver(), "direct");
+            direct.setDatabaseName(tmpDir.filePath(QStringLiteral("direct.db")));
+        }
     }
     void cleanup()
     {
@@ -29,6 +75,9 @@ private slots:
         db.setConnectOptions();
         db.setPassword(QString());
         db.close();
+        QSqlDatabase direct = QSqlDatabase::database("direct", false);
+        direct.setConnectOptions();
+        direct.close();
     }
     void open()
     {
@@ -42,12 +91,933 @@ private slots:
         QVERIFY2(ok,msg.toLatin1().constData());
          db.close();
     }
+    void bindTypes()
+    {
+        QSqlDatabase db = QSqlDatabase::database("db");
+        QVERIFY(db.isOpen());
+        QSqlQuery query(db);
+        QVERIFY(query.prepare("SELECT typeof(?) || ',' || typeof(?) || ',' || typeof(?) || ',' || typeof(?)"
+                              " || ',' || typeof(?) || ',' || typeof(?)"));
+        query.addBindValue(QByteArray("\x00\x01", 2));
+        query.addBindValue(QDate(2024, 2, 29));
+        query.addBindValue(QTime(12, 30));
+        query.addBindValue(QDateTime(QDate(2024, 2, 29), QTime(12, 30), Qt::UTC));
+        query.addBindValue(Q_UINT64_C(18446744073709551615));
+        query.addBindValue(1.5f);
+        QVERIFY2(query.exec(), qPrintable(query.lastError().text()));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toString(), QStringLiteral("BLOB,DATE,TIME,TIMESTAMP,UBIGINT,FLOAT"));
+
+        // 32 bit integers stay 32 bit unless the parameter is wider
+        QVERIFY(query.prepare("SELECT typeof(?) || ',' || typeof(?) || ',' || typeof(?), ?::BIGINT + 1"));
+        query.addBindValue(42);
+        query.addBindValue(qint64(42));
+        query.addBindValue(7u);
+        query.addBindValue(std::numeric_limits<int>::max());
+        QVERIFY2(query.exec(), qPrintable(query.lastError().text()));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toString(), QStringLiteral("INTEGER,BIGINT,UINTEGER"));
+        QCOMPARE(query.value(1).toLongLong(), Q_INT64_C(2147483648));
+    }
+    void bindList()
+    {
+        QSqlDatabase db = QSqlDatabase::database("db");
+        QVERIFY(db.isOpen());
+        QSqlQuery query(db);
+        QVERIFY(query.prepare("SELECT count(*)::VARCHAR FROM range(100) t(i) WHERE i IN (SELECT unnest(?))"));
+        query.addBindValue(QVariantList{ 1, 5, 7, 1000 });
+        QVERIFY2(query.exec(), qPrintable(query.lastError().text()));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toString(), QStringLiteral("3"));
+
+        // mixed numbers share a type that keeps every value
+        QVERIFY(query.prepare("SELECT list_sum(?)::VARCHAR"));
+        query.addBindValue(QVariantList{ 1.5f, 2.5 });
+        QVERIFY2(query.exec(), qPrintable(query.lastError().text()));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toDouble(), 4.0);
+        QVERIFY(query.prepare("SELECT list_sum(?)::VARCHAR"));
+        query.addBindValue(QVariantList{ -1, Q_UINT64_C(18446744073709551615) });
+        QVERIFY2(query.exec(), qPrintable(query.lastError().text()));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toString(), QStringLiteral("18446744073709551614"));
+        // and fail when there is none, a DOUBLE would round integers above 2^53
+        QVERIFY(query.prepare("SELECT list_sum(?)::VARCHAR"));
+        query.addBindValue(QVariantList{ (Q_INT64_C(1) << 53) + 1, 2.5 });
+        QVERIFY(!query.exec());
+        QVERIFY(query.prepare("SELECT list_sum(?)::VARCHAR"));
+        query.addBindValue(QVariantList{ 1, QStringLiteral("a") });
+        QVERIFY(!query.exec());
+
+        // an empty list compares with any column type
+        QVERIFY(query.prepare("SELECT count(*)::VARCHAR FROM range(100) t(i) WHERE i = ANY(?)"));
+        query.addBindValue(QVariantList());
+        QVERIFY2(query.exec(), qPrintable(query.lastError().text()));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toString(), QStringLiteral("0"));
+    }
+    void fetchChunks()
+    {
+        QSqlDatabase db = QSqlDatabase::database("db");
+        QVERIFY(db.isOpen());
+        QSqlQuery query(db);
+        QVERIFY2(query.exec("SELECT i FROM range(5000) t(i)"), qPrintable(query.lastError().text()));
+        qint64 expected = 0;
+        while (query.next())
+            QCOMPARE(query.value(0).toLongLong(), expected++);
+        QCOMPARE(expected, qint64(5000));
+    }
+    void fetchNested()
+    {
+        QSqlDatabase db = QSqlDatabase::database("db");
+        QVERIFY(db.isOpen());
+        QSqlQuery query(db);
+        QVERIFY2(query.exec("SELECT [1, 2, NULL], {'a': 1, 'b': 'x'}, MAP {'k': [2.5::DOUBLE]}, [[1], []]"),
+                 qPrintable(query.lastError().text()));
+        QVERIFY(query.next());
+        const QVariantList list = query.value(0).toList();
+        QCOMPARE(list.size(), 3);
+        QCOMPARE(list.at(1).toInt(), 2);
+        QVERIFY(list.at(2).isNull());
+        const QVariantMap record = query.value(1).toMap();
+        QCOMPARE(record.value("a").toInt(), 1);
+        QCOMPARE(record.value("b").toString(), QStringLiteral("x"));
+        QCOMPARE(query.value(2).toMap().value("k").toList().value(0).toDouble(), 2.5);
+        QCOMPARE(query.value(3).toList().size(), 2);
+        QVERIFY(!query.next());
+    }
+    void fetchDecimal()
+    {
+        QSqlDatabase db = QSqlDatabase::database("db");
+        QVERIFY(db.isOpen());
+        QSqlQuery query(db);
+        const QString sql = QStringLiteral("SELECT 12.345::DECIMAL(18,8), -0.5::DECIMAL(38,10), 7::HUGEINT");
+        QVERIFY2(query.exec(sql), qPrintable(query.lastError().text()));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toDouble(), 12.345);
+        QCOMPARE(query.value(1).toDouble(), -0.5);
+
+        query.setNumericalPrecisionPolicy(QSql::HighPrecision);
+        QVERIFY2(query.exec(sql), qPrintable(query.lastError().text()));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toString(), QStringLiteral("12.34500000"));
+        QCOMPARE(query.value(1).toString(), QStringLiteral("-0.5000000000"));
+        QCOMPARE(query.value(2).toString(), QStringLiteral("7"));
+
+        query.setNumericalPrecisionPolicy(QSql::LowPrecisionInt64);
+        QVERIFY2(query.exec(sql), qPrintable(query.lastError().text()));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toLongLong(), qint64(12));
+        // integers beyond the range of the policy saturate instead of wrapping or dropping to 0
+        const QString wide = QStringLiteral("SELECT 123456789012345678901234.5::DECIMAL(38,1),"
+                                            " -170141183460469231731687303715884105727::HUGEINT,"
+                                            " 5000000000.25::DECIMAL(18,2), 0.5::DECIMAL(38,1)");
+        QVERIFY2(query.exec(wide), qPrintable(query.lastError().text()));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toLongLong(), std::numeric_limits<qint64>::max());
+        QCOMPARE(query.value(1).toLongLong(), std::numeric_limits<qint64>::min());
+        QCOMPARE(query.value(2).toLongLong(), Q_INT64_C(5000000000));
+        QCOMPARE(query.value(3).toLongLong(), Q_INT64_C(0));
+
+        query.setNumericalPrecisionPolicy(QSql::LowPrecisionInt32);
+        QVERIFY2(query.exec(wide), qPrintable(query.lastError().text()));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toInt(), std::numeric_limits<int>::max());
+        QCOMPARE(query.value(1).toInt(), std::numeric_limits<int>::min());
+        QCOMPARE(query.value(2).toInt(), std::numeric_limits<int>::max());
+    }
+    void fetchTemporal()
+    {
+        QSqlDatabase db = QSqlDatabase::database("db");
+        QVERIFY(db.isOpen());
+        QSqlQuery query(db);
+        QVERIFY2(query.exec("SELECT DATE '2024-02-29', TIME '12:30:15.250', TIMESTAMP '1969-12-31 23:59:59.9995',"
+                            " TIMESTAMP_MS '2024-02-29 12:30:00', NULL::DATE"),
+                 qPrintable(query.lastError().text()));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toDate(), QDate(2024, 2, 29));
+        QCOMPARE(query.value(1).toTime(), QTime(12, 30, 15, 250));
+        QCOMPARE(query.value(2).toDateTime().toMSecsSinceEpoch(), qint64(-1));
+        QCOMPARE(query.value(3).toDateTime(), QDateTime(QDate(2024, 2, 29), QTime(12, 30), Qt::UTC));
+        QVERIFY(query.value(4).isNull());
+        QCOMPARE(query.value(4).type(), QVariant::Date);
+    }
+    void fetchBlob()
+    {
+        QSqlDatabase db = QSqlDatabase::database("db");
+        db.close();
+        db.setConnectOptions(QStringLiteral("QDUCKDB_ZERO_COPY_BLOBS"));
+        QVERIFY(db.open());
+        QSqlQuery query(db);
+        QVERIFY2(query.exec("SELECT repeat('ab', 1000)::BLOB, '\\x00\\x01'::BLOB FROM range(3000)"),
+                 qPrintable(query.lastError().text()));
+        int rows = 0;
+        while (query.next()) {
+            QCOMPARE(query.value(0).toByteArray().size(), 2000);
+            QCOMPARE(query.value(1).toByteArray(), QByteArray("\x00\x01", 2));
+            ++rows;
+        }
+        QCOMPARE(rows, 3000);
+
+        // a detached copy owns its bytes once the result set is gone
+        QVERIFY2(query.exec("SELECT repeat('cd', 100)::BLOB"), qPrintable(query.lastError().text()));
+        QVERIFY(query.next());
+        QByteArray kept = query.value(0).toByteArray();
+        kept.detach();
+        query.finish();
+        QCOMPARE(kept, QByteArray("cd").repeated(100));
+    }
+    void fetchSparse()
+    {
+        QSqlDatabase db = QSqlDatabase::database("db");
+        QVERIFY(db.isOpen());
+        QSqlQuery query(db);
+        QVERIFY2(query.exec("SELECT CASE WHEN i % 100 = 7 THEN i::INTEGER END, CASE WHEN i % 2 = 0 THEN 0::BIGINT END"
+                            " FROM range(3000) t(i)"),
+                 qPrintable(query.lastError().text()));
+        int rows = 0;
+        while (query.next()) {
+            if (rows % 100 == 7)
+                QCOMPARE(query.value(0).toInt(), rows);
+            else
+                QVERIFY(query.value(0).isNull());
+            QCOMPARE(query.value(0).type(), QVariant::Int);
+            QCOMPARE(query.value(1).isNull(), rows % 2 != 0);
+            ++rows;
+        }
+        QCOMPARE(rows, 3000);
+    }
+    void fetchForwardOnly()
+    {
+        QSqlDatabase db = QSqlDatabase::database("db");
+        QVERIFY(db.isOpen());
+        QSqlQuery query(db);
+        query.setForwardOnly(true);
+        QVERIFY2(query.exec("SELECT i, 'v' || i::VARCHAR, CASE WHEN i % 2 = 0 THEN i END FROM range(5000) t(i)"),
+                 qPrintable(query.lastError().text()));
+        qint64 rows = 0;
+        while (query.next()) {
+            QCOMPARE(query.value(0).toLongLong(), rows);
+            QCOMPARE(query.value(1).toString(), QStringLiteral("v%1").arg(rows));
+            QCOMPARE(query.isNull(2), rows % 2 != 0);
+            ++rows;
+        }
+        QCOMPARE(rows, qint64(5000));
+
+        QVERIFY(query.exec("SELECT i FROM range(3000) t(i)"));
+        QVERIFY(query.last());
+        QCOMPARE(query.value(0).toLongLong(), qint64(2999));
+    }
+    void fetchEnum()
+    {
+        QSqlDatabase db = QSqlDatabase::database("db");
+        db.close();
+        db.setConnectOptions(QStringLiteral("QDUCKDB_INTERN_STRINGS"));
+        QVERIFY(db.open());
+        QSqlQuery query(db);
+        QVERIFY2(query.exec("SELECT (['low', 'high'])[i % 2 + 1]::ENUM('low', 'high'), 'k' || (i % 3)::VARCHAR,"
+                            " NULL::ENUM('a') FROM range(5000) t(i)"),
+                 qPrintable(query.lastError().text()));
+        int rows = 0;
+        while (query.next()) {
+            QCOMPARE(query.value(0).toString(), QString::fromLatin1(rows % 2 ? "high" : "low"));
+            QCOMPARE(query.value(1).toString(), QStringLiteral("k%1").arg(rows % 3));
+            QVERIFY(query.value(2).isNull());
+            QCOMPARE(query.value(2).type(), QVariant::String);
+            ++rows;
+        }
+        QCOMPARE(rows, 5000);
+    }
+    void schemaCache()
+    {
+        QSqlDatabase db = QSqlDatabase::database("db");
+        QVERIFY(db.isOpen());
+        QSqlQuery query(db);
+        QVERIFY2(query.exec("CREATE OR REPLACE TABLE schema_cache (id INTEGER PRIMARY KEY, name VARCHAR NOT NULL)"),
+                 qPrintable(query.lastError().text()));
+        QVERIFY(db.tables().contains(QStringLiteral("schema_cache")));
+        QCOMPARE(db.record("schema_cache").count(), 2);
+        QCOMPARE(db.primaryIndex("schema_cache").count(), 1);
+        QCOMPARE(db.primaryIndex("schema_cache").fieldName(0), QStringLiteral("id"));
+        QVERIFY(db.record("schema_cache").field(1).requiredStatus() == QSqlField::Required);
+
+        {
+            // a second connection to the same file shares the database and its cache
+            QSqlDatabase other = QSqlDatabase::addDatabase("DUCKDB", "other");
+            other.setDatabaseName(db.databaseName());
+            QVERIFY2(other.open(), qPrintable(other.lastError().text()));
+            QCOMPARE(other.record("schema_cache").count(), 2);
+            QSqlQuery alter(other);
+            QVERIFY2(alter.exec("ALTER TABLE schema_cache ADD COLUMN price DOUBLE"), qPrintable(alter.lastError().text()));
+            other.close();
+        }
+        QSqlDatabase::removeDatabase("other");
+        QCOMPARE(db.record("schema_cache").count(), 3);
+
+        QVERIFY2(query.exec("CREATE OR REPLACE TABLE schema_types (a BIGINT, b DECIMAL(18,3), c TIMESTAMP, d INTEGER[],"
+                            " e UUID)"), qPrintable(query.lastError().text()));
+        const QSqlRecord types = db.record("schema_types");
+        QCOMPARE(types.field(0).type(), QVariant::LongLong);
+        QCOMPARE(types.field(1).type(), QVariant::Double);
+        QCOMPARE(types.field(1).precision(), 3);
+        QCOMPARE(types.field(2).type(), QVariant::DateTime);
+        QCOMPARE(types.field(3).type(), QVariant::List);
+        QCOMPARE(types.field(4).type(), QVariant::Uuid);
+        QVERIFY(query.exec("DROP TABLE schema_types"));
+
+        QVERIFY(query.exec("DROP TABLE schema_cache"));
+        QVERIFY(!db.tables().contains(QStringLiteral("schema_cache")));
+        QVERIFY(db.record("schema_cache").isEmpty());
+    }
+    void schemaCacheTransaction()
+    {
+        QSqlDatabase db = QSqlDatabase::database("db");
+        QVERIFY(db.isOpen());
+        QSqlQuery query(db);
+        QVERIFY(query.exec("DROP TABLE IF EXISTS pending"));
+        {
+            QSqlDatabase other = QSqlDatabase::addDatabase("DUCKDB", "other");
+            other.setDatabaseName(db.databaseName());
+            QVERIFY2(other.open(), qPrintable(other.lastError().text()));
+
+            // the DDL of an open transaction is not shared through the cache
+            QVERIFY(db.transaction());
+            QVERIFY(query.exec("CREATE TABLE pending (id INTEGER)"));
+            QCOMPARE(db.record("pending").count(), 1);
+            QVERIFY(other.record("pending").isEmpty());
+            QVERIFY(db.rollback());
+            QVERIFY(db.record("pending").isEmpty());
+            QVERIFY(other.record("pending").isEmpty());
+
+            // a shared database keeps the access mode it was opened with
+            QSqlDatabase reader = QSqlDatabase::addDatabase("DUCKDB", "reader");
+            reader.setDatabaseName(db.databaseName());
+            reader.setConnectOptions("QDUCKDB_OPEN_READONLY");
+            QVERIFY(!reader.open());
+            other.close();
+        }
+        QSqlDatabase::removeDatabase("other");
+        QSqlDatabase::removeDatabase("reader");
+    }
+    void preparedRecord()
+    {
+        QSqlDatabase db = QSqlDatabase::database("db");
+        QVERIFY(db.isOpen());
+        QSqlQuery query(db);
+        QVERIFY(query.prepare("SELECT ?::INTEGER AS id, 'x' AS name, 2.5::DOUBLE AS price"));
+        const QSqlRecord record = query.record();
+        QCOMPARE(record.count(), 3);
+        QCOMPARE(record.fieldName(1), QStringLiteral("name"));
+        QCOMPARE(record.field(0).type(), QVariant::Int);
+        QCOMPARE(record.field(1).type(), QVariant::String);
+        QCOMPARE(record.field(2).type(), QVariant::Double);
+
+        query.addBindValue(7);
+        QVERIFY2(query.exec(), qPrintable(query.lastError().text()));
+        QCOMPARE(query.record().count(), 3);
+
+        QVERIFY(query.prepare("SELECT i FROM range(3) t(i) WHERE i > $min -- trailing comment"));
+        QCOMPARE(query.record().count(), 1);
+        QCOMPARE(query.record().fieldName(0), QStringLiteral("i"));
+        QCOMPARE(query.record().field(0).type(), QVariant::LongLong);
+        QVERIFY(query.prepare("CREATE OR REPLACE TEMP TABLE described (i INTEGER)"));
+        QVERIFY(query.record().isEmpty());
+    }
+    void rowsAffected()
+    {
+        QSqlDatabase db = QSqlDatabase::database("db");
+        QVERIFY(db.isOpen());
+        QSqlQuery query(db);
+        QVERIFY(query.exec("CREATE OR REPLACE TEMP TABLE affected (id INTEGER)"));
+        QVERIFY(!query.isSelect());
+        QVERIFY(query.prepare("INSERT INTO affected SELECT * FROM range(?)"));
+        query.addBindValue(25);
+        QVERIFY2(query.exec(), qPrintable(query.lastError().text()));
+        QVERIFY(!query.isSelect());
+        QCOMPARE(query.numRowsAffected(), 25);
+        QVERIFY(query.exec("UPDATE affected SET id = id + 1 WHERE id < 10"));
+        QCOMPARE(query.numRowsAffected(), 10);
+        QVERIFY(query.exec("DELETE FROM affected RETURNING id"));
+        QVERIFY(query.isSelect());
+        QVERIFY(query.next());
+    }
+    void multipleResults()
+    {
+        QSqlDatabase db = QSqlDatabase::database("db");
+        QVERIFY(db.isOpen());
+        QVERIFY(db.driver()->hasFeature(QSqlDriver::MultipleResultSets));
+        QSqlQuery query(db);
+        QVERIFY(query.prepare("CREATE OR REPLACE TEMP TABLE script (id INTEGER);"
+                              "INSERT INTO script SELECT * FROM range(?);"
+                              "SELECT count(*) FROM script WHERE id >= ?"));
+        query.addBindValue(10);
+        query.addBindValue(4);
+        QVERIFY2(query.exec(), qPrintable(query.lastError().text()));
+        QVERIFY(!query.isSelect());
+        QVERIFY2(query.nextResult(), qPrintable(query.lastError().text()));
+        QCOMPARE(query.numRowsAffected(), 10);
+        QVERIFY2(query.nextResult(), qPrintable(query.lastError().text()));
+        QVERIFY(query.isSelect());
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toInt(), 6);
+        QVERIFY(!query.nextResult());
+
+        // every statement runs on exec(), even if nextResult() is never called
+        QVERIFY2(query.exec("INSERT INTO script VALUES (100); INSERT INTO script VALUES (101)"),
+                 qPrintable(query.lastError().text()));
+        QVERIFY2(query.exec("SELECT count(*) FROM script WHERE id >= 100"), qPrintable(query.lastError().text()));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toInt(), 2);
+    }
+    void groupCommit()
+    {
+        QSqlDatabase db = QSqlDatabase::database("db");
+        QVERIFY(db.isOpen());
+        QSqlQuery query(db);
+        QVERIFY2(query.exec("CREATE OR REPLACE TABLE grouped (writer INTEGER, id INTEGER)"),
+                 qPrintable(query.lastError().text()));
+
+        const int writers = 8;
+        QAtomicInt committed;
+        std::vector<std::thread> threads;
+        for (int writer = 0; writer < writers; ++writer) {
+            threads.emplace_back([writer, &committed, name = db.databaseName()]() {
+                const QString connection = QStringLiteral("group%1").arg(writer);
+                {
+                    QSqlDatabase group = QSqlDatabase::addDatabase("DUCKDB", connection);
+                    group.setDatabaseName(name);
+                    group.setConnectOptions("QDUCKDB_GROUP_COMMIT=50");
+                    if (group.open() && group.transaction()) {
+                        QSqlQuery insert(group);
+                        insert.prepare("INSERT INTO grouped SELECT ?, range FROM range(3)");
+                        insert.addBindValue(writer);
+                        if (insert.exec() && group.commit())
+                            committed.ref();
+                    }
+                    group.close();
+                }
+                QSqlDatabase::removeDatabase(connection);
+            });
+        }
+        for (std::thread &thread : threads)
+            thread.join();
+        QCOMPARE(committed.load(), writers);
+        QVERIFY(query.exec("SELECT count(*), count(DISTINCT writer) FROM grouped"));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toInt(), writers * 3);
+        QCOMPARE(query.value(1).toInt(), writers);
+    }
+    void groupCommitFailure()
+    {
+        QSqlDatabase db = QSqlDatabase::database("db");
+        QVERIFY(db.isOpen());
+        QSqlQuery query(db);
+        QVERIFY2(query.exec("CREATE OR REPLACE TABLE grouped (writer INTEGER, id INTEGER CHECK (id >= 0))"),
+                 qPrintable(query.lastError().text()));
+
+        // the failing writer loses its own rows only, the others of its group still commit
+        const int writers = 6;
+        const int failing = 2;
+        QAtomicInt committed;
+        QAtomicInt failedCommit;
+        std::vector<std::thread> threads;
+        for (int writer = 0; writer < writers; ++writer) {
+            threads.emplace_back([writer, &committed, &failedCommit, name = db.databaseName()]() {
+                const QString connection = QStringLiteral("group%1").arg(writer);
+                {
+                    QSqlDatabase group = QSqlDatabase::addDatabase("DUCKDB", connection);
+                    group.setDatabaseName(name);
+                    group.setConnectOptions("QDUCKDB_GROUP_COMMIT=200");
+                    if (group.open() && group.transaction()) {
+                        QSqlQuery insert(group);
+                        insert.prepare("INSERT INTO grouped SELECT ?, range FROM range(3)");
+                        insert.addBindValue(writer);
+                        bool ok = insert.exec();
+                        if (ok && writer == failing) {
+                            QSqlQuery invalid(group);
+                            ok = !invalid.exec(QStringLiteral("INSERT INTO grouped VALUES (%1, -1)").arg(writer));
+                            if (ok && !group.commit())
+                                failedCommit.ref();
+                        } else if (ok && group.commit()) {
+                            committed.ref();
+                        }
+                    }
+                    group.close();
+                }
+                QSqlDatabase::removeDatabase(connection);
+            });
+        }
+        for (std::thread &thread : threads)
+            thread.join();
+        QCOMPARE(committed.load(), writers - 1);
+        QCOMPARE(failedCommit.load(), 1);
+        QVERIFY(query.exec(QStringLiteral("SELECT count(*), count(DISTINCT writer), count(*) FILTER (WHERE writer = %1) FROM grouped").arg(failing)));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toInt(), (writers - 1) * 3);
+        QCOMPARE(query.value(1).toInt(), writers - 1);
+        QCOMPARE(query.value(2).toInt(), 0);
+    }
+    void groupCommitSameThread()
+    {
+        QSqlDatabase db = QSqlDatabase::database("db");
+        QVERIFY(db.isOpen());
+        QSqlQuery query(db);
+        QVERIFY2(query.exec("CREATE OR REPLACE TABLE grouped (writer INTEGER, id INTEGER)"),
+                 qPrintable(query.lastError().text()));
+        {
+            QSqlDatabase first = QSqlDatabase::addDatabase("DUCKDB", "first");
+            QSqlDatabase second = QSqlDatabase::addDatabase("DUCKDB", "second");
+            for (QSqlDatabase *group : { &first, &second }) {
+                group->setDatabaseName(db.databaseName());
+                group->setConnectOptions("QDUCKDB_GROUP_COMMIT=50;QDUCKDB_BUSY_TIMEOUT=1000");
+                QVERIFY2(group->open(), qPrintable(group->lastError().text()));
+            }
+
+            // prepared before the transaction, it still runs inside it and is rolled back with it
+            QSqlQuery early(first);
+            QVERIFY(early.prepare("INSERT INTO grouped VALUES (1, 1)"));
+            QVERIFY(first.transaction());
+            QVERIFY2(early.exec(), qPrintable(early.lastError().text()));
+            QVERIFY(first.rollback());
+
+            // one thread holding two grouped transactions does not wait for itself
+            QVERIFY(first.transaction());
+            QVERIFY(second.transaction());
+            QVERIFY(early.exec());
+            QSqlQuery late(second);
+            QVERIFY(late.exec("INSERT INTO grouped VALUES (2, 1)"));
+            QElapsedTimer timer;
+            timer.start();
+            QVERIFY2(first.commit(), qPrintable(first.lastError().text()));
+            QVERIFY2(second.commit(), qPrintable(second.lastError().text()));
+            QVERIFY(timer.elapsed() < 1000);
+            first.close();
+            second.close();
+        }
+        QSqlDatabase::removeDatabase("first");
+        QSqlDatabase::removeDatabase("second");
+        QVERIFY(query.exec("SELECT count(*), count(DISTINCT writer) FROM grouped"));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toInt(), 2);
+        QCOMPARE(query.value(1).toInt(), 2);
+    }
+    void backgroundCheckpoint()
+    {
+        QSqlDatabase db = QSqlDatabase::database("db");
+        db.close();
+        db.setConnectOptions("QDUCKDB_CHECKPOINT_IDLE=50");
+        QVERIFY2(db.open(), qPrintable(db.lastError().text()));
+        QSqlQuery query(db);
+        QVERIFY2(query.exec("CREATE OR REPLACE TABLE checkpointed AS SELECT range AS id FROM range(10000)"),
+                 qPrintable(query.lastError().text()));
+        const QFileInfo wal(db.databaseName() + QStringLiteral(".wal"));
+        QTRY_VERIFY_WITH_TIMEOUT(!QFileInfo::exists(wal.filePath()) || QFileInfo(wal.filePath()).size() == 0, 5000);
+    }
+    void notifications()
+    {
+        QSqlDatabase db = QSqlDatabase::database("db");
+        db.close();
+        db.setConnectOptions("QDUCKDB_NOTIFY_INTERVAL=200");
+        QVERIFY2(db.open(), qPrintable(db.lastError().text()));
+        QSqlQuery query(db);
+        QVERIFY2(query.exec("CREATE OR REPLACE TABLE notified (id INTEGER)"), qPrintable(query.lastError().text()));
+        QVERIFY(db.driver()->subscribeToNotification("notified"));
+
+        QVector<QPair<qint64, QSqlDriver::NotificationSource>> received;
+        const QMetaObject::Connection connection = connect(db.driver(),
+                QOverload<const QString &, QSqlDriver::NotificationSource, const QVariant &>::of(&QSqlDriver::notification),
+                this, [&received](const QString &name, QSqlDriver::NotificationSource source, const QVariant &payload) {
+                    if (name == QLatin1String("notified"))
+                        received.append(qMakePair(payload.toLongLong(), source));
+                });
+
+        QVERIFY(query.exec("INSERT INTO notified SELECT * FROM range(5)"));
+        {
+            QSqlDatabase other = QSqlDatabase::addDatabase("DUCKDB", "other");
+            other.setDatabaseName(db.databaseName());
+            QVERIFY2(other.open(), qPrintable(other.lastError().text()));
+            QSqlQuery change(other);
+            QVERIFY(change.exec("-- comment; with a semicolon\nINSERT INTO main.notified VALUES (1), (2)"));
+            QVERIFY(change.exec("UPDATE \"notified\" SET id = 0 WHERE id = 1"));
+            QVERIFY(change.exec("SELECT count(*) FROM notified"));
+            other.close();
+        }
+        QSqlDatabase::removeDatabase("other");
+        QTRY_COMPARE(received.size(), 1);
+        QCOMPARE(received.at(0).first, qint64(9));
+        QCOMPARE(received.at(0).second, QSqlDriver::UnknownSource);
+
+        // changes within the interval are coalesced, rolled back ones are not reported
+        QVERIFY(query.exec("INSERT INTO notified VALUES (7)"));
+        QVERIFY(db.transaction());
+        QVERIFY(query.exec("DELETE FROM notified"));
+        QVERIFY(db.rollback());
+        QVERIFY(query.exec("INSERT INTO notified VALUES (8)"));
+        QTRY_COMPARE(received.size(), 2);
+        QCOMPARE(received.at(1).first, qint64(2));
+        QCOMPARE(received.at(1).second, QSqlDriver::SelfSource);
+
+        // a table of the same name in another schema is another table,
+        // transactions run as SQL hold their changes back like db.transaction()
+        QVERIFY2(query.exec("CREATE SCHEMA IF NOT EXISTS elsewhere"), qPrintable(query.lastError().text()));
+        QVERIFY2(query.exec("CREATE OR REPLACE TABLE elsewhere.notified (id INTEGER)"), qPrintable(query.lastError().text()));
+        QVERIFY(query.exec("INSERT INTO elsewhere.notified VALUES (1)"));
+        QVERIFY(query.exec("BEGIN"));
+        QVERIFY(query.exec("INSERT INTO notified VALUES (9), (10)"));
+        QVERIFY(query.exec("ROLLBACK"));
+        QVERIFY2(query.exec("BEGIN; INSERT INTO notified VALUES (11); COMMIT"), qPrintable(query.lastError().text()));
+        QTRY_COMPARE(received.size(), 3);
+        QCOMPARE(received.at(2).first, qint64(1));
+        disconnect(connection);
+    }
+    void arrowSchema()
+    {
+        QSqlDatabase db = QSqlDatabase::database("direct");
+        QVERIFY2(db.isOpen(), qPrintable(db.lastError().text()));
+        QSqlQuery query(db);
+        QVERIFY(query.prepare("SELECT ?::INTEGER AS id, 'x' AS name, 2.5::DECIMAL(9,2) AS price, [1, 2] AS list"));
+        query.addBindValue(7);
+        QVERIFY2(query.exec(), qPrintable(query.lastError().text()));
+
+        ArrowSchema schema;
+        QVERIFY(duckdbResult(query)->exportArrowSchema(&schema));
+        QCOMPARE(schema.n_children, int64_t(4));
+        QCOMPARE(QByteArray(schema.children[0]->name), QByteArray("id"));
+        QCOMPARE(QByteArray(schema.children[0]->format), QByteArray("i"));
+        QCOMPARE(QByteArray(schema.children[1]->format), QByteArray("u"));
+        QCOMPARE(QByteArray(schema.children[2]->format), QByteArray("d:9,2"));
+        QCOMPARE(QByteArray(schema.children[3]->format), QByteArray("+l"));
+        QCOMPARE(schema.children[3]->n_children, int64_t(1));
+        QCOMPARE(QByteArray(schema.children[3]->children[0]->format), QByteArray("i"));
+        schema.release(&schema);
+
+        ArrowArrayStream stream;
+        QVERIFY(duckdbResult(query)->exportArrowStream(&stream));
+        QCOMPARE(stream.get_schema(&stream, &schema), 0);
+        ArrowArray array;
+        QCOMPARE(stream.get_next(&stream, &array), 0);
+        QVERIFY(array.release);
+        QCOMPARE(array.n_children, schema.n_children);
+        QCOMPARE(array.length, int64_t(1));
+        array.release(&array);
+        schema.release(&schema);
+        stream.release(&stream);
+    }
+    void arrowIpcRoundTrip()
+    {
+        QSqlDatabase db = QSqlDatabase::database("direct");
+        QVERIFY2(db.isOpen(), qPrintable(db.lastError().text()));
+        QSqlQuery query(db);
+        QVERIFY(query.exec("SELECT range AS id, 'row ' || range AS name,"
+                           " CASE WHEN range % 3 = 0 THEN NULL ELSE range * 1.5 END::DOUBLE AS price,"
+                           " [range, range + 1] AS pair FROM range(5000)"));
+        for (QDuckdbResult::ArrowIpcFormat format : { QDuckdbResult::ArrowIpcStream, QDuckdbResult::ArrowIpcFile }) {
+            // a registered file stays mapped, each format gets a file of its own
+            const QString fileName = tmpDir.filePath(QStringLiteral("result%1.arrow").arg(int(format)));
+            QFile file(fileName);
+            QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+            QVERIFY(duckdbResult(query)->exportArrowIpc(&file, format));
+            file.close();
+
+            QVERIFY2(duckdbDriver(db)->registerArrowIpcFile(QStringLiteral("ipc_copy"), fileName),
+                     qPrintable(db.lastError().text()));
+            QSqlQuery copy(db);
+            QVERIFY(copy.exec("SELECT count(*), sum(id), count(price), sum(len(pair)),"
+                              " max(name) FILTER (WHERE id = 4321) FROM ipc_copy"));
+            QVERIFY(copy.next());
+            QCOMPARE(copy.value(0).toLongLong(), Q_INT64_C(5000));
+            QCOMPARE(copy.value(1).toLongLong(), Q_INT64_C(12497500));
+            QCOMPARE(copy.value(2).toLongLong(), Q_INT64_C(3333));
+            QCOMPARE(copy.value(3).toLongLong(), Q_INT64_C(10000));
+            QCOMPARE(copy.value(4).toString(), QStringLiteral("row 4321"));
+            // the view scans the mapping again for every query
+            QVERIFY(copy.exec("SELECT count(*) FROM ipc_copy"));
+            QVERIFY(copy.next());
+            QCOMPARE(copy.value(0).toLongLong(), Q_INT64_C(5000));
+        }
+
+        // a truncated file is rejected rather than read past its end
+        const QString fileName = tmpDir.filePath(QStringLiteral("truncated.arrow"));
+        QVERIFY(QFile::copy(tmpDir.filePath(QStringLiteral("result%1.arrow").arg(int(QDuckdbResult::ArrowIpcFile))),
+                            fileName));
+        QVERIFY(QFile::resize(fileName, QFileInfo(fileName).size() / 2));
+        QVERIFY(!duckdbDriver(db)->registerArrowIpcFile(QStringLiteral("ipc_truncated"), fileName));
+    }
+    void forEachRow()
+    {
+        QSqlDatabase db = QSqlDatabase::database("db");
+        QVERIFY(db.isOpen());
+        QSqlQuery query(db);
+        QVERIFY2(query.exec("SELECT i::INTEGER, 'row ' || i, (i * 1.25)::DECIMAL(9,2), i::UTINYINT,"
+                            " TIMESTAMP '1969-12-31 23:59:59.9995' FROM range(4) t(i)"),
+                 qPrintable(query.lastError().text()));
+        qint64 ids = 0;
+        double prices = 0;
+        int rows = 0;
+        const bool ok = QDuckdb::forEachRow<qint64, QString, double, quint16, QDateTime>(
+                    query, [&](qint64 id, const QString &name, double price, quint16 small, const QDateTime &at) {
+            QCOMPARE(name, QStringLiteral("row %1").arg(id));
+            QCOMPARE(qint64(small), id);
+            QCOMPARE(at.toMSecsSinceEpoch(), Q_INT64_C(-1));
+            ids += id;
+            prices += price;
+            ++rows;
+        });
+        QVERIFY(ok);
+        QCOMPARE(rows, 4);
+        QCOMPARE(ids, Q_INT64_C(6));
+        QCOMPARE(prices, 7.5);
+
+        // a type that cannot hold every value of the column is refused
+        QVERIFY(query.exec("SELECT 1::INTEGER, 1::UBIGINT"));
+        QVERIFY(!QDuckdb::forEachRow<qint16, quint64>(query, [](qint16, quint64) {}));
+        QVERIFY(!QDuckdb::forEachRow<qint64, qint64>(query, [](qint64, qint64) {}));
+        QVERIFY(QDuckdb::forEachRow<qint32, quint64>(query, [](qint32, quint64) {}));
+    }
+    void typedAccessors()
+    {
+        QSqlDatabase db = QSqlDatabase::database("db");
+        QVERIFY(db.isOpen());
+        const QString sql = QStringLiteral("SELECT 42::INTEGER, 2.5::DECIMAL(4,1), 'text', NULL::INTEGER,"
+                                           " 18446744073709551615::UBIGINT, 3.5::DOUBLE");
+        for (bool forwardOnly : { true, false }) {
+            QSqlQuery query(db);
+            query.setForwardOnly(forwardOnly);
+            QVERIFY2(query.exec(sql), qPrintable(query.lastError().text()));
+            QVERIFY(query.next());
+            const QDuckdbResult *result = QDuckdb::result(query);
+            QVERIFY(result);
+            QVERIFY(!result->isNullAt(0));
+            QVERIFY(result->isNullAt(3));
+            QCOMPARE(result->int64At(0), Q_INT64_C(42));
+            QCOMPARE(result->int64At(1), Q_INT64_C(2));
+            QCOMPARE(result->doubleAt(1), 2.5);
+            QCOMPARE(result->stringAt(2).toString(), QStringLiteral("text"));
+            QCOMPARE(result->stringAt(0).toString(), QStringLiteral("42"));
+            QCOMPARE(result->int64At(4), std::numeric_limits<qint64>::max());
+            QCOMPARE(result->doubleAt(5), 3.5);
+        }
+    }
+    void transactionRetries()
+    {
+        QSqlDatabase db = QSqlDatabase::database("direct");
+        QVERIFY2(db.isOpen(), qPrintable(db.lastError().text()));
+        QSqlQuery query(db);
+        QVERIFY2(query.exec("CREATE OR REPLACE TABLE contended AS SELECT 1 AS id, 0 AS v"),
+                 qPrintable(query.lastError().text()));
+        QDuckdbDriver *driver = duckdbDriver(db);
+        const quint64 retries = driver->transactionRetries();
+        const quint64 aborts = driver->transactionAborts();
+        {
+            QSqlDatabase other = QSqlDatabase::addDatabase(new QDuckdbDriver(), "contender");
+            other.setDatabaseName(db.databaseName());
+            QVERIFY2(other.open(), qPrintable(other.lastError().text()));
+
+            // the other connection commits a change to the row after the transaction began
+            int attempts = 0;
+            int contended = 1;
+            const auto work = [&]() {
+                QSqlQuery read(db);
+                if (!read.exec("SELECT v FROM contended WHERE id = 1"))
+                    return false;
+                if (attempts++ < contended)
+                    QSqlQuery(other).exec("UPDATE contended SET v = v + 10 WHERE id = 1");
+                return QSqlQuery(db).exec("UPDATE contended SET v = v + 1 WHERE id = 1");
+            };
+            QVERIFY(driver->runTransaction(work));
+            QCOMPARE(attempts, 2);
+            QCOMPARE(driver->transactionRetries(), retries + 1);
+            QCOMPARE(driver->transactionAborts(), aborts);
+
+            // a conflict on every attempt gives up after maxRetries
+            attempts = 0;
+            contended = 3;
+            QVERIFY(!driver->runTransaction(work, 1));
+            QCOMPARE(attempts, 2);
+            QCOMPARE(driver->transactionRetries(), retries + 2);
+            QCOMPARE(driver->transactionAborts(), aborts + 1);
+            other.close();
+        }
+        QSqlDatabase::removeDatabase("contender");
+        QVERIFY(query.exec("SELECT v FROM contended"));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toInt(), 31);
+    }
+    void registerColumns()
+    {
+        QSqlDatabase db = QSqlDatabase::database("direct");
+        QVERIFY2(db.isOpen(), qPrintable(db.lastError().text()));
+        const QVector<QPair<QString, QVector<qint64>>> columns = {
+            { QStringLiteral("z"), { 1, 2, 3 } },
+            { QStringLiteral("a"), { 10, 20, 30 } },
+            { QStringLiteral("m"), { 100, 200, 300 } },
+        };
+        QVERIFY2(QDuckdb::registerColumns(db, QStringLiteral("registered"), columns),
+                 qPrintable(db.lastError().text()));
+        QSqlQuery query(db);
+        QVERIFY(query.exec("SELECT * FROM registered ORDER BY z"));
+        QCOMPARE(query.record().fieldName(0), QStringLiteral("z"));
+        QCOMPARE(query.record().fieldName(1), QStringLiteral("a"));
+        QCOMPARE(query.record().fieldName(2), QStringLiteral("m"));
+        QVERIFY(query.last());
+        QCOMPARE(query.value(1).toLongLong(), Q_INT64_C(30));
+
+        // columns of different lengths are refused
+        QVERIFY(!QDuckdb::registerColumns<qint64>(db, QStringLiteral("uneven"),
+                                                  { { QStringLiteral("a"), { 1, 2 } }, { QStringLiteral("b"), { 1 } } }));
+
+        // the error of a stream that fails to describe itself reaches lastError()
+        ArrowArrayStream stream = ArrowArrayStream();
+        stream.get_schema = [](ArrowArrayStream *, ArrowSchema *) { return 1; };
+        stream.get_last_error = [](ArrowArrayStream *) { return "no schema available"; };
+        stream.release = [](ArrowArrayStream *released) { released->release = nullptr; };
+        QVERIFY(!duckdbDriver(db)->registerArrowStream(QStringLiteral("broken"), &stream));
+        QCOMPARE(db.driver()->lastError().databaseText(), QStringLiteral("no schema available"));
+    }
+    void writeQueue()
+    {
+        QSqlDatabase db = QSqlDatabase::database("direct");
+        QVERIFY2(db.isOpen(), qPrintable(db.lastError().text()));
+        QSqlQuery query(db);
+        QVERIFY(query.exec("CREATE OR REPLACE TABLE queued (id INTEGER NOT NULL, name VARCHAR)"));
+        {
+            // nothing is flushed unless asked for, at most three rows are pending
+            QScopedPointer<QDuckdbWriteQueue> queue(duckdbDriver(db)->createWriteQueue("queued", 1000000, 600000, 3));
+            QVERIFY2(queue, qPrintable(db.lastError().text()));
+            for (int id = 0; id < 3; ++id)
+                QVERIFY(queue->enqueue(QVector<QVariant>{ id, QStringLiteral("row") }));
+            QVERIFY(!queue->enqueue(QVector<QVariant>{ 3, QStringLiteral("row") }, 50));
+            QVERIFY(queue->flush().result());
+            QVERIFY(query.exec("SELECT count(*) FROM queued"));
+            QVERIFY(query.next());
+            QCOMPARE(query.value(0).toInt(), 3);
+
+            // a failed batch writes none of its rows and can be queued again
+            QVERIFY(queue->enqueue(QVector<QVariant>{ 3, QStringLiteral("row") }, 1000));
+            QVERIFY(queue->enqueue(QVector<QVariant>{ QVariant(), QStringLiteral("null id") }, 1000));
+            QVERIFY(!queue->flush().result());
+            QVERIFY(queue->lastError().isValid());
+            QVERIFY(queue->enqueue(QVector<QVariant>{ 3, QStringLiteral("row") }, 1000));
+            QVERIFY(queue->flush().result());
+
+            // the rows still queued are written when the queue is destroyed
+            QVERIFY(queue->enqueue(QVector<QVariant>{ 4, QStringLiteral("row") }, 1000));
+            QVERIFY(queue->enqueue(QVector<QVariant>{ 5, QStringLiteral("row") }, 1000));
+        }
+        QVERIFY(query.exec("SELECT count(*), count(DISTINCT id) FROM queued"));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toInt(), 6);
+        QCOMPARE(query.value(1).toInt(), 6);
+    }
+    void gadgetColumns()
+    {
+        QSqlDatabase db = QSqlDatabase::database("direct");
+        QVERIFY2(db.isOpen(), qPrintable(db.lastError().text()));
+        QSqlQuery query(db);
+        QVERIFY(query.exec("CREATE OR REPLACE TABLE gadgets (id INTEGER, name VARCHAR)"));
+        QVector<Product> rows(2);
+        rows[0].id = 1;
+        rows[0].name = QStringLiteral("a");
+        rows[1].id = 2;
+        rows[1].name = QStringLiteral("b");
+        QVERIFY2(QDuckdb::appendGadgets(db, "gadgets", rows), qPrintable(db.lastError().text()));
+
+        // the mapping follows the table once its columns change
+        QVERIFY(query.exec("ALTER TABLE gadgets ADD COLUMN price DOUBLE"));
+        QVERIFY2(QDuckdb::appendGadgets(db, "gadgets", rows), qPrintable(db.lastError().text()));
+        QVERIFY(query.exec("SELECT count(*), count(price) FROM gadgets"));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toInt(), 4);
+        QCOMPARE(query.value(1).toInt(), 0);
+
+        // and each result by its column names, whatever their order
+        QVector<Product> read;
+        QVERIFY(query.exec("SELECT id, name FROM gadgets ORDER BY id LIMIT 2"));
+        QVERIFY(QDuckdb::readGadgets(query, &read));
+        QCOMPARE(read.size(), 2);
+        QCOMPARE(read.at(0).name, QStringLiteral("a"));
+        read.clear();
+        QVERIFY(query.exec("SELECT name, id, price FROM gadgets ORDER BY id DESC LIMIT 1"));
+        QVERIFY(QDuckdb::readGadgets(query, &read));
+        QCOMPARE(read.size(), 1);
+        QCOMPARE(read.at(0).id, 2);
+        QCOMPARE(read.at(0).name, QStringLiteral("b"));
+    }
+    void gadgetTypes()
+    {
+        QSqlDatabase db = QSqlDatabase::database("direct");
+        QVERIFY2(db.isOpen(), qPrintable(db.lastError().text()));
+        QSqlQuery query(db);
+        QVERIFY(query.exec("CREATE OR REPLACE TABLE samples (id BIGINT, value DOUBLE, valid BOOLEAN, payload BLOB,"
+                           " day DATE, taken TIMESTAMP, time TIME)"));
+        QVector<Sample> rows(2);
+        rows[0].id = Q_INT64_C(1) << 40;
+        rows[0].value = 1.5;
+        rows[0].valid = true;
+        rows[0].payload = QByteArray("a\0b", 3);
+        rows[0].day = QDate(1969, 12, 31);
+        rows[0].taken = QDateTime(QDate(2024, 2, 29), QTime(12, 30, 15, 250), Qt::UTC);
+        rows[0].time = QTime(8, 15);
+        rows[1].id = 2;
+        QVERIFY2(QDuckdb::appendGadgets(db, "samples", rows), qPrintable(db.lastError().text()));
+        QVERIFY(query.exec("SELECT count(payload), count(day), count(taken) FROM samples"));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toInt(), 1);
+        QCOMPARE(query.value(1).toInt(), 1);
+        QCOMPARE(query.value(2).toInt(), 1);
+
+        // an INTEGER column widens into the qint64 property, NULL cells leave their property alone
+        QVector<Sample> read;
+        QVERIFY(query.exec("SELECT id::INTEGER AS id, payload, day FROM samples WHERE id = 2"));
+        QVERIFY(QDuckdb::readGadgets(query, &read));
+        QCOMPARE(read.size(), 1);
+        QCOMPARE(read.at(0).id, Q_INT64_C(2));
+        QVERIFY(read.at(0).payload.isNull());
+        QVERIFY(!read.at(0).day.isValid());
+
+        // TIME has no typed setter and goes through QVariant
+        read.clear();
+        QVERIFY(query.exec("SELECT * FROM samples WHERE id > 2"));
+        QVERIFY(QDuckdb::readGadgets(query, &read));
+        QCOMPARE(read.size(), 1);
+        QCOMPARE(read.at(0).id, rows.at(0).id);
+        QCOMPARE(read.at(0).value, 1.5);
+        QCOMPARE(read.at(0).valid, true);
+        QCOMPARE(read.at(0).payload, rows.at(0).payload);
+        QCOMPARE(read.at(0).day, rows.at(0).day);
+        QCOMPARE(read.at(0).taken, rows.at(0).taken);
+        QCOMPARE(read.at(0).time, rows.at(0).time);
+    }
+    void bindDevice()
+    {
+        QSqlDatabase db = QSqlDatabase::database("db");
+        QVERIFY(db.isOpen());
+        QByteArray payload(300000, 'x');
+        payload[0] = '\0';
+        QBuffer buffer(&payload);
+        QVERIFY(buffer.open(QIODevice::ReadOnly));
+        QSqlQuery query(db);
+        QVERIFY(query.prepare("SELECT octet_length(?)::VARCHAR"));
+        query.addBindValue(QVariant::fromValue<QIODevice *>(&buffer));
+        QVERIFY2(query.exec(), qPrintable(query.lastError().text()));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toString(), QString::number(payload.size()));
+    }
 
     void cleanupTestCase()
     {
         QSqlDatabase::removeDatabase("db");
+        QSqlDatabase::removeDatabase("direct");
     }
 private:
+    static QDuckdbDriver *duckdbDriver(const QSqlDatabase &db)
+    {
+        return static_cast<QDuckdbDriver *>(db.driver());
+    }
+    static const QDuckdbResult *duckdbResult(const QSqlQuery &query)
+    {
+        return static_cast<const QDuckdbResult *>(query.result());
+    }
     QTemporaryDir tmpDir;
 };
 
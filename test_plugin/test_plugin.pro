@@ -19,3 +19,18 @@ DEFINES += QT_DEPRECATED_WARNINGS
 
 # Input
 SOURCES += main.cpp
+
+# The driver is also compiled in, the tests of its C++ extensions reach it through a
+# QDuckdbDriver handed to QSqlDatabase::addDatabase(). QT_PLUGIN keeps its classes
+# unexported as in the plugin build.
+QT += core-private sql-private
+DEFINES += QT_PLUGIN
+include($$PWD/../duckdb/duckdb/duckdb.pri)
+INCLUDEPATH += $$PWD/../duckdb
+HEADERS += $$PWD/../duckdb/qsql_duckdb_p.h \
+           $$PWD/../duckdb/qsql_duckdb_rows.h \
+           $$PWD/../duckdb/qsql_duckdb_arrow.h \
+           $$PWD/../duckdb/qsql_duckdb_arrow_ipc_p.h \
+           $$PWD/../duckdb/qsql_duckdb_database_p.h
+SOURCES += $$PWD/../duckdb/qsql_duckdb.cpp $$PWD/../duckdb/qsql_duckdb_arrow_ipc.cpp \
+           $$PWD/../duckdb/qsql_duckdb_database.cpp